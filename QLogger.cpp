@@ -1,10 +1,14 @@
 #include "QLogger.h"
 
+#include "QLoggerCompressor.h"
+#include "QLoggerConsole.h"
+#include "QLoggerThread.h"
 #include "QLoggerWriter.h"
 
 #include <QDateTime>
-#include <QDebug>
+#include <QDeadlineTimer>
 #include <QDir>
+#include <QSaveFile>
 
 Q_DECLARE_METATYPE(QLogger::LogLevel)
 Q_DECLARE_METATYPE(QLogger::LogMode)
@@ -19,7 +23,6 @@ void QLog_(const QString &module, LogLevel level, const QString &message, const
     QLoggerManager::getInstance()->enqueueMessage(module, level, message, function, file, line);
 }
 
-static const int QUEUE_LIMIT = 100;
 
 QLoggerManager *QLoggerManager::getInstance()
 {
@@ -28,17 +31,28 @@ QLoggerManager *QLoggerManager::getInstance()
     return &INSTANCE;
 }
 
+QLoggerManager::QLoggerManager()
+{
+    // The shared instances used by the writers are created first so they are destroyed after the manager. The
+    // compressions tell the retention when they are done, so it is destroyed after the compressor.
+    QLoggerRetention::getInstance();
+    QLoggerCompressor::getInstance();
+    QLoggerConsole::getInstance();
+}
+
 bool QLoggerManager::addDestination(const QString &fileDest, const QString &module, LogLevel level, const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions, bool notify)
 {
     QMutexLocker lock(&mMutex);
 
+    if (mShutdown)
+        return false;
+
     if (!mModuleDest.contains(module))
     {
         const auto log = createWriter(fileDest, level, fileFolderDestination, mode, fileSuffixIfFull, messageOptions);
 
-        mModuleDest.insert(module, log);
-
-        startWriter(module, log, mode, notify);
+        addModule(module, log, levelOrDefault(level), mode, notify);
+        publishModules();
 
         return true;
     }
@@ -49,6 +63,10 @@ bool QLoggerManager::addDestination(const QString &fileDest, const QString &modu
 bool QLoggerManager::addDestination(const QString &fileDest, const QStringList &modules, LogLevel level, const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions, bool notify)
 {
     QMutexLocker lock(&mMutex);
+
+    if (mShutdown)
+        return false;
+
     bool allAdded = false;
 
     for (const auto &module : modules)
@@ -57,21 +75,41 @@ bool QLoggerManager::addDestination(const QString &fileDest, const QStringList &
         {
             const auto log = createWriter(fileDest, level, fileFolderDestination, mode, fileSuffixIfFull, messageOptions);
 
-            mModuleDest.insert(module, log);
-
-            startWriter(module, log, mode, notify);
+            addModule(module, log, levelOrDefault(level), mode, notify);
 
             allAdded = true;
         }
     }
 
+    if (allAdded)
+        publishModules();
+
     return allAdded;
 }
 
-QLoggerWriter *QLoggerManager::createWriter(const QString &fileDest, LogLevel level, const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions) const
+bool QLoggerManager::addSink(const QString &module, std::shared_ptr<QLoggerSink> sink)
+{
+    QMutexLocker lock(&mMutex);
+
+    const auto log = mModuleDest.value(module, nullptr);
+
+    if (!log || !sink)
+        return false;
+
+    log->addSink(std::move(sink));
+
+    return true;
+}
+
+LogLevel QLoggerManager::levelOrDefault(LogLevel level) const
+{
+    return level == LogLevel::Warning ? mDefaultLevel : level;
+}
+
+QLoggerWriter *QLoggerManager::createWriter(const QString &fileDest, LogLevel level, const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions)
 {
     const auto lFileDest              = fileDest.isEmpty() ? mDefaultFileDestination : fileDest;
-    const auto lLevel                 = level == LogLevel::Warning ? mDefaultLevel : level;
+    const auto lLevel                 = levelOrDefault(level);
     const auto lFileFolderDestination = fileFolderDestination.isEmpty()
                                             ? mDefaultFileDestinationFolder
                                             : QDir::fromNativeSeparators(fileFolderDestination);
@@ -81,48 +119,196 @@ QLoggerWriter *QLoggerManager::createWriter(const QString &fileDest, LogLevel le
     const auto lMessageOptions
         = messageOptions.testFlag(LogMessageDisplay::Default) ? mDefaultMessageOptions : messageOptions;
 
+    const auto path = QLoggerWriter::destinationPath(lFileDest, lFileFolderDestination);
+
+    // Modules that log in the same file share its writer
+    if (const auto existing = mWriters.value(path, nullptr))
+        return existing;
+
     const auto log
         = new QLoggerWriter(lFileDest, lLevel, lFileFolderDestination, lMode, lFileSuffixIfFull, lMessageOptions);
 
+    mWriters.insert(path, log);
+
     log->setMaxFileSize(mDefaultMaxFileSize);
-    log->stop(mIsStop);
+    log->setQueueCapacity(mDefaultQueueCapacity, mDefaultQueueMaxBytes);
+    log->setOverflowPolicy(mDefaultOverflowPolicy, mDefaultSampleRate);
+    log->setCompression(mDefaultCompression, mDefaultCompressionLevel);
+    log->setFlushPolicy(mDefaultFlushLatency, mDefaultFlushBatchMessages, mDefaultFlushBatchBytes);
+    log->setDurability(mDefaultFlushLevel, mDefaultSyncInterval);
+    log->setRingSize(mDefaultRingSize);
+    log->setFormat(mDefaultFormat);
+    log->setEscaping(mDefaultEscaping);
+    log->applyStop(mIsStop);
+
+    if (mDefaultRetention.isEnabled())
+        log->setRetention(mDefaultRetention);
 
     return log;
 }
 
+void QLoggerManager::addModule(const QString &module, QLoggerWriter *log, LogLevel level, LogMode mode, bool notify)
+{
+    const auto entry = moduleEntry(module);
+
+    entry->level = level;
+    entry->writer.store(log, std::memory_order_release);
+    mModuleDest.insert(module, log);
+
+    // The modules are filtered by their own level, the writer only needs to accept the lowest one
+    if (level < log->getLevel())
+        log->applyLevel(level);
+
+    updateMinimumLevel();
+
+    startWriter(module, log, mode, notify);
+    writeAndDequeueMessages(module);
+}
+
 void QLoggerManager::startWriter(const QString &module, QLoggerWriter *log, LogMode mode, bool notify)
 {
+    // The modules of a file share its writer, which is only attached once
+    if (!log->isActive())
+    {
+        if (mWriterThreads > 0)
+        {
+            if (mWriterPool->threadCount() == 0)
+                mWriterPool->setThreadCount(mWriterThreads);
+
+            log->setPool(mWriterPool.get());
+        }
+        else if (mode != LogMode::Disabled)
+            log->start(QThread::HighPriority);
+    }
+
+    // Enqueued once the writer is attached, so the pool schedules its batch
     if (notify)
     {
-        const auto threadId = QString("%1").arg((quintptr)QThread::currentThread(), QT_POINTER_SIZE * 2, 16, QChar('0'));
-        log->enqueue(QDateTime::currentDateTime(), threadId, module, LogLevel::Info, "", "", -1, "Adding destination!");
+        LogRecord record;
+        record.timestamp = QLoggerClock::now();
+        record.threadId  = QLoggerThread::currentId();
+        record.level     = LogLevel::Info;
+        record.module    = &mModules.value(module)->name;
+        record.message   = QStringLiteral("Adding destination!");
+
+        log->enqueue(std::move(record));
     }
+}
+
+const char *QLoggerManager::internString(const QString &text)
+{
+    QMutexLocker lock(&mInternMutex);
 
-    if (mode != LogMode::Disabled)
-        log->start(QThread::HighPriority);
+    return internStringLocked(text);
 }
 
-void QLoggerManager::clearFileDestinationFolder(const QString &fileFolderDestination, int days, const QStringList &listFilter)
+const char *QLoggerManager::internStringLocked(const QString &text)
 {
-    QDir dir(fileFolderDestination);
+    const auto utf8 = text.toUtf8();
+    auto iter       = mInternedStrings.constFind(utf8);
 
-    if (!dir.exists())
-        return;
+    if (iter == mInternedStrings.constEnd())
+        iter = mInternedStrings.insert(utf8);
+
+    return iter->constData();
+}
 
-    dir.setFilter(QDir::Files | QDir::Hidden | QDir::NoSymLinks);
-    dir.setNameFilters(listFilter);
+const LogCallSite *QLoggerManager::internSite(const QString &function, const QString &file, int line, LogLevel level)
+{
+    const auto hash = qHash(function, qHash(file, qHash(line, static_cast<size_t>(level))));
+    auto &slot      = mSiteCache[hash % mSiteCache.size()];
+
+    // The sites are never removed, so a cached one can be read without the lock
+    if (const auto cached = slot.load(std::memory_order_acquire); cached && cached->matches(function, file, line, level))
+        return &cached->site;
+
+    QMutexLocker lock(&mInternMutex);
 
-    const auto list = dir.entryInfoList();
-    const auto now  = QDateTime::currentDateTime();
+    const auto first = mInternedSiteIndex.value(hash, nullptr);
 
-    for (const auto &fileInfoIter : list)
+    for (auto interned = first; interned; interned = interned->next)
     {
-        if (fileInfoIter.lastModified().daysTo(now) >= days)
+        if (interned->matches(function, file, line, level))
         {
-            // remove file
-            dir.remove(fileInfoIter.fileName());
+            slot.store(interned, std::memory_order_release);
+            return &interned->site;
         }
     }
+
+    const auto functionName = internStringLocked(function);
+    const auto fileName     = fileBaseName(internStringLocked(file));
+    const LogCallSite site { functionName, fileName, line, level, &mInternedRates.emplace_back() };
+
+    const auto &interned = mInternedSites.emplace_back(InternedSite { function, file, site, first });
+    mInternedSiteIndex.insert(hash, &interned);
+    slot.store(&interned, std::memory_order_release);
+
+    return &interned.site;
+}
+
+void QLoggerManager::publishModules()
+{
+    auto snapshot = std::make_unique<ModuleSnapshot>();
+    snapshot->reserve(mModules.size());
+
+    for (auto iter = mModules.cbegin(); iter != mModules.cend(); ++iter)
+        snapshot->insert(iter.key(), iter.value());
+
+    mModuleSnapshot.publish(std::move(snapshot));
+}
+
+const QLoggerManager::Module *QLoggerManager::findModule(const QString &module) const
+{
+    const auto modules = mModuleSnapshot.read();
+
+    return modules ? modules->value(module, nullptr) : nullptr;
+}
+
+void QLoggerManager::clearFileDestinationFolder(const QString &fileFolderDestination, int days, const QStringList &listFilter)
+{
+    QLoggerRetention::getInstance()->clearFolder(fileFolderDestination, days, listFilter);
+}
+
+bool QLoggerManager::setRetention(const QString &module, const LogRetention &retention)
+{
+    QMutexLocker lock(&mMutex);
+
+    const auto log = mModuleDest.value(module, nullptr);
+
+    if (!log)
+        return false;
+
+    log->setRetention(retention);
+
+    return true;
+}
+
+void QLoggerManager::setDefaultLevel(LogLevel level)
+{
+    mDefaultLevel = level;
+
+    updateMinimumLevel();
+}
+
+void QLoggerManager::setCompressionThreads(int threads)
+{
+    QLoggerCompressor::getInstance()->setMaxThreadCount(threads);
+}
+
+void QLoggerManager::setWriterThreads(int threads)
+{
+    QMutexLocker lock(&mMutex);
+
+    mWriterThreads = qMax(threads, 0);
+
+    // The destinations already in the pool keep it
+    if (mWriterThreads > 0 && mWriterPool->threadCount() > 0)
+        mWriterPool->setThreadCount(mWriterThreads);
+}
+
+void QLoggerManager::setConsoleColors(bool colors)
+{
+    QLoggerConsole::getInstance()->setColors(colors);
 }
 
 void QLoggerManager::setDefaultFileDestinationFolder(const QString &fileDestinationFolder)
@@ -134,56 +320,322 @@ void QLoggerManager::writeAndDequeueMessages(const QString &module)
 {
     QMutexLocker lock(&mMutex);
 
-    const auto logWriter = mModuleDest.value(module, nullptr);
+    const auto entry  = mModules.value(module, nullptr);
+    const auto writer = entry ? entry->writer.load(std::memory_order_acquire) : nullptr;
 
-    if (logWriter && !logWriter->isStop())
-    {
-        const auto values = mNonWriterQueue.values(module);
+    if (!writer || writer->isStop())
+        return;
+
+    auto records = mPendingRecords.take(module);
 
-        for (const auto &vals : values)
+    for (auto &record : records)
+    {
+        if (entry->isEnabled(record.level))
         {
-            const auto level = qvariant_cast<LogLevel>(vals.at(2).toInt());
+            record.module = &entry->name;
+            writer->enqueue(std::move(record));
+        }
+    }
+}
+
+QLoggerManager::Module *QLoggerManager::moduleEntry(const QString &module)
+{
+    auto entry = mModules.value(module, nullptr);
+
+    if (!entry)
+    {
+        entry       = new Module;
+        entry->name = module;
+        entry->enabledLevel.store(static_cast<int>(mDefaultLevel), std::memory_order_relaxed);
+
+        mModules.insert(module, entry);
+    }
+
+    return entry;
+}
+
+ModuleHandle QLoggerManager::module(const QString &module)
+{
+    QMutexLocker lock(&mMutex);
+
+    const auto known = mModules.contains(module);
+    const auto entry = moduleEntry(module);
+
+    // The lookups by name must find the same entry
+    if (!known)
+        publishModules();
+
+    return ModuleHandle(entry);
+}
 
-            if (logWriter->getLevel() <= level)
+void QLoggerManager::enqueueMessage(const QString &module, LogLevel level, const QString &message, const QString &function, const QString &file, int line)
+{
+    // The site is only interned for the messages that can be written
+    if (static_cast<int>(level) < mMinimumLevel.load(std::memory_order_relaxed))
+        return;
+
+    const auto site = internSite(function, file, line, level);
+
+    if (isModuleEnabled(module, site))
+        enqueueMessage(module, site, message);
+}
+
+void QLoggerManager::enqueueMessage(const QString &module, const LogCallSite *site, const QString &message, LogFields fields)
+{
+    const auto level = site->level;
+    const auto entry = findModule(module);
+
+    if (entry && !entry->isEnabled(level))
+        return;
+
+    LogRecord record;
+    record.timestamp = QLoggerClock::now();
+    record.threadId  = QLoggerThread::currentId();
+    record.level     = level;
+    record.site      = site;
+    record.message   = message;
+    record.fields    = std::move(fields);
+
+    if (!entry)
+    {
+        enqueueNonWriterMessage(module, std::move(record));
+        return;
+    }
+
+    enqueueRecord(entry, std::move(record));
+}
+
+void QLoggerManager::enqueueMessage(const ModuleHandle &module, const LogCallSite *site, const QString &message, LogFields fields)
+{
+    const auto entry = module.mModule;
+    const auto level = site->level;
+
+    if (!entry || !entry->isEnabled(level))
+        return;
+
+    LogRecord record;
+    record.timestamp = QLoggerClock::now();
+    record.threadId  = QLoggerThread::currentId();
+    record.level     = level;
+    record.site      = site;
+    record.message   = message;
+    record.fields    = std::move(fields);
+
+    enqueueRecord(entry, std::move(record));
+}
+
+void QLoggerManager::enqueueRecord(const Module *entry, LogRecord &&record)
+{
+    const auto writer = entry->writer.load(std::memory_order_acquire);
+
+    if (!writer)
+    {
+        enqueueNonWriterMessage(entry->name, std::move(record));
+        return;
+    }
+
+    record.module = &entry->name;
+
+    writer->enqueue(std::move(record));
+}
+
+bool QLoggerManager::isModuleEnabled(const QString &module, LogLevel level) const
+{
+    const auto entry = findModule(module);
+
+    return !entry || entry->isEnabled(level);
+}
+
+bool QLoggerManager::isModuleEnabled(const QString &module, const LogCallSite *site)
+{
+    const auto entry = findModule(module);
+
+    return !entry || (entry->isEnabled(site->level) && acquireRate(entry, site));
+}
+
+bool QLoggerManager::acquireRate(const Module *entry, const LogCallSite *site)
+{
+    auto &limit         = entry->rateLimits[static_cast<int>(site->level)];
+    const auto interval = limit.interval.load(std::memory_order_relaxed);
+
+    if (interval == 0)
+        return true;
+
+    const auto perCallSite = limit.perCallSite.load(std::memory_order_relaxed) && site->rate;
+    auto &rate             = perCallSite ? *site->rate : limit.moduleRate;
+    const auto tolerance   = limit.tolerance.load(std::memory_order_relaxed);
+    const auto now         = QLoggerClock::now();
+    auto fullTick          = rate.fullTick.load(std::memory_order_relaxed);
+
+    // Every message moves the tick one interval ahead; it can't go further than the tolerance from now
+    for (;;)
+    {
+        const auto start = qMax(fullTick, now);
+
+        if (start - now > tolerance)
+        {
+            // The first suppressed message of a flood makes the budget checked by the reporter
+            if (rate.suppressed.fetch_add(1) == 0 && !rate.pending.exchange(true))
             {
-                const auto datetime = vals.at(0).toDateTime();
-                const auto threadId = vals.at(1).toString();
-                const auto function = vals.at(3).toString();
-                const auto file     = vals.at(4).toString();
-                const auto line     = vals.at(5).toInt();
-                const auto message  = vals.at(6).toString();
-
-                logWriter->enqueue(datetime, threadId, module, level, function, file, line, message);
+                QMutexLocker lock(&mRateMutex);
+                mSuppressedRates.append({ entry, site, &rate, perCallSite });
             }
+
+            return false;
         }
 
-        mNonWriterQueue.remove(module);
+        if (rate.fullTick.compare_exchange_weak(fullTick, start + interval, std::memory_order_relaxed))
+            break;
     }
+
+    if (const auto suppressed = rate.suppressed.exchange(0))
+        enqueueSuppressed(entry, site, site->level, suppressed, now);
+
+    return true;
 }
 
-void QLoggerManager::enqueueMessage(const QString &module, LogLevel level, const QString &message, const QString &function, const QString &file, int line)
+void QLoggerManager::enqueueSuppressed(const Module *entry, const LogCallSite *site, LogLevel level, quint64 suppressed, qint64 timestamp)
+{
+    LogRecord record;
+    record.timestamp = timestamp;
+    record.threadId  = QLoggerThread::currentId();
+    record.level     = level;
+    record.module    = &entry->name;
+    record.site      = site;
+    record.message   = QString("%1 messages suppressed").arg(suppressed);
+
+    enqueueRecord(entry, std::move(record));
+}
+
+void QLoggerManager::reportSuppressed(bool all)
+{
+    QVector<SuppressedRate> rates;
+
+    {
+        QMutexLocker lock(&mRateMutex);
+        rates.swap(mSuppressedRates);
+    }
+
+    const auto now = QLoggerClock::now();
+    QVector<SuppressedRate> kept;
+
+    for (const auto &suppressed : qAsConst(rates))
+    {
+        auto &rate = *suppressed.rate;
+
+        // A budget that is not full yet still gets messages: the next one allowed reports the count
+        if (!all && rate.fullTick.load(std::memory_order_relaxed) > now)
+        {
+            kept.append(suppressed);
+            continue;
+        }
+
+        // The module budget is shared by the call sites, its count is not given to one of them
+        const auto site = suppressed.perCallSite ? suppressed.site : &NO_CALL_SITE;
+
+        if (const auto count = rate.suppressed.exchange(0))
+            enqueueSuppressed(suppressed.entry, site, suppressed.site->level, count, now);
+
+        // A message suppressed since the exchange either sees the flag cleared and adds the budget, or is seen here
+        rate.pending.store(false);
+
+        if (rate.suppressed.load() > 0 && !rate.pending.exchange(true))
+            kept.append(suppressed);
+    }
+
+    if (!kept.isEmpty())
+    {
+        QMutexLocker lock(&mRateMutex);
+        mSuppressedRates.append(kept);
+    }
+}
+
+void QLoggerManager::setRateLimit(const QString &module, LogLevel level, int messagesPerSecond, int burst, LogRateScope scope)
+{
+    QMutexLocker lock(&mMutex);
+
+    const auto known    = mModules.contains(module);
+    auto &limit         = moduleEntry(module)->rateLimits[static_cast<int>(level)];
+    const auto interval = messagesPerSecond > 0 ? qint64(1000000000) / messagesPerSecond : 0;
+
+    limit.perCallSite.store(scope == LogRateScope::CallSite, std::memory_order_relaxed);
+    limit.tolerance.store(interval * (qMax(burst, 1) - 1), std::memory_order_relaxed);
+    limit.interval.store(interval, std::memory_order_relaxed);
+
+    // The counts of the floods that stop are reported once their budget is full again
+    if (interval > 0 && !mRateReporter)
+        mRateReporter = std::make_unique<QLoggerPeriodicJob>(250, [this]() { reportSuppressed(false); });
+
+    if (!known)
+        publishModules();
+}
+
+void QLoggerManager::updateMinimumLevel()
 {
     QMutexLocker lock(&mMutex);
-    const auto logWriter    = mModuleDest.value(module, nullptr);
-    const auto isLogEnabled = logWriter && logWriter->getMode() != LogMode::Disabled && !logWriter->isStop();
 
-    if (isLogEnabled && logWriter->getLevel() <= level)
+    auto minimumLevel = static_cast<int>(mDefaultLevel);
+
+    for (const auto entry : qAsConst(mModules))
     {
-        const auto threadId = QString("%1").arg((quintptr)QThread::currentThread(), QT_POINTER_SIZE * 2, 16, QChar('0'));
-        const auto fileName = file.mid(file.lastIndexOf('/') + 1);
+        const auto writer = entry->writer.load(std::memory_order_relaxed);
 
-        writeAndDequeueMessages(module);
+        // Modules without destination keep what passes the default level until they get one
+        const auto enabledLevel = writer ? qMax(static_cast<int>(entry->level), writer->getEnabledLevel())
+                                         : static_cast<int>(mDefaultLevel);
 
-        logWriter->enqueue(QDateTime::currentDateTime(), threadId, module, level, function, fileName, line, message);
+        entry->enabledLevel.store(enabledLevel, std::memory_order_relaxed);
+        minimumLevel = qMin(minimumLevel, enabledLevel);
     }
-    else if (!logWriter && mNonWriterQueue.count(module) < QUEUE_LIMIT)
+
+    mMinimumLevel.store(minimumLevel, std::memory_order_relaxed);
+}
+
+void QLoggerManager::writerLevelChanged(QLoggerWriter *writer)
+{
+    QMutexLocker lock(&mMutex);
+
+    for (const auto entry : qAsConst(mModules))
     {
-        const auto threadId = QString("%1").arg((quintptr)QThread::currentThread(), QT_POINTER_SIZE * 2, 16, QChar('0'));
-        const auto fileName = file.mid(file.lastIndexOf('/') + 1);
+        if (entry->writer.load(std::memory_order_relaxed) == writer)
+            entry->level = writer->getLevel();
+    }
 
-        mNonWriterQueue.insert(module,
-                               {QDateTime::currentDateTime(), threadId, QVariant::fromValue<LogLevel>(level), function, fileName, line, message});
+    updateMinimumLevel();
+}
+
+void QLoggerManager::enqueueNonWriterMessage(const QString &module, LogRecord &&record)
+{
+    QMutexLocker lock(&mMutex);
+
+    // The destination may have been added since the snapshot was read
+    const auto entry  = mModules.value(module, nullptr);
+    const auto writer = entry ? entry->writer.load(std::memory_order_acquire) : nullptr;
+
+    if (writer)
+    {
+        lock.unlock();
+
+        if (entry->isEnabled(record.level))
+        {
+            record.module = &entry->name;
+            writer->enqueue(std::move(record));
+        }
+
+        return;
     }
+
+    auto &records = mPendingRecords[module];
+
+    if (records.size() < mPreRegistrationLimit)
+        records.append(std::move(record));
+}
+
+void QLoggerManager::setPreRegistrationLimit(int messages)
+{
+    QMutexLocker lock(&mMutex);
+
+    mPreRegistrationLimit = qMax(messages, 0);
 }
 
 void QLoggerManager::pause()
@@ -192,8 +644,10 @@ void QLoggerManager::pause()
 
     mIsStop = true;
 
-    for (auto &logWriter : mModuleDest)
-        logWriter->stop(mIsStop);
+    for (auto &logWriter : mWriters)
+        logWriter->applyStop(true);
+
+    updateMinimumLevel();
 }
 
 void QLoggerManager::resume()
@@ -202,8 +656,89 @@ void QLoggerManager::resume()
 
     mIsStop = false;
 
-    for (auto &logWriter : mModuleDest)
-        logWriter->stop(mIsStop);
+    for (auto &logWriter : mWriters)
+        logWriter->applyStop(false);
+
+    updateMinimumLevel();
+
+    // Messages of modules added while paused are still waiting
+    for (auto iter = mModuleDest.cbegin(); iter != mModuleDest.cend(); ++iter)
+        writeAndDequeueMessages(iter.key());
+}
+
+void QLoggerManager::flushAll()
+{
+    reportSuppressed(true);
+
+    // The writers are only destroyed with the manager, so they can be waited for without holding the lock
+    QList<QLoggerWriter *> writers;
+
+    {
+        QMutexLocker lock(&mMutex);
+        writers = mWriters.values();
+    }
+
+    // All the writers write at the same time, then we wait for each one
+    for (const auto logWriter : writers)
+        logWriter->forcePush();
+
+    for (const auto logWriter : writers)
+        logWriter->flush();
+}
+
+LogStats QLoggerManager::stats() const
+{
+    QMutexLocker lock(&mMutex);
+
+    LogStats stats;
+    stats.writers.reserve(mWriters.size());
+
+    for (const auto logWriter : mWriters)
+        stats.writers.append(logWriter->stats());
+
+    stats.compression = QLoggerCompressor::getInstance()->stats();
+
+    return stats;
+}
+
+void QLoggerManager::setStatsExport(int interval, LogStatsFormat format, const QString &target)
+{
+    // The previous exporter is stopped without the lock, its last export may be waiting for it
+    std::unique_ptr<QLoggerPeriodicJob> previous;
+
+    {
+        QMutexLocker lock(&mMutex);
+        previous = std::move(mStatsExporter);
+    }
+
+    previous.reset();
+
+    if (interval <= 0)
+        return;
+
+    QMutexLocker lock(&mMutex);
+
+    mStatsExporter = std::make_unique<QLoggerPeriodicJob>(interval, [this, format, target]() {
+        const auto stats = this->stats();
+
+        if (format == LogStatsFormat::Prometheus)
+        {
+            QSaveFile file(target);
+
+            if (file.open(QIODevice::WriteOnly))
+            {
+                file.write(stats.toPrometheus().toUtf8());
+                file.commit();
+            }
+
+            return;
+        }
+
+        static constexpr LogCallSite site { "QLoggerManager::setStatsExport", "QLogger.cpp", -1, LogLevel::Info };
+
+        for (const auto &line : stats.toText())
+            enqueueMessage(target, &site, line);
+    });
 }
 
 void QLoggerManager::overwriteLogMode(LogMode mode)
@@ -212,8 +747,10 @@ void QLoggerManager::overwriteLogMode(LogMode mode)
 
     setDefaultMode(mode);
 
-    for (auto &logWriter : mModuleDest)
-        logWriter->setLogMode(mode);
+    for (auto &logWriter : mWriters)
+        logWriter->applyMode(mode);
+
+    updateMinimumLevel();
 }
 
 void QLoggerManager::overwriteLogLevel(LogLevel level)
@@ -222,46 +759,178 @@ void QLoggerManager::overwriteLogLevel(LogLevel level)
 
     setDefaultLevel(level);
 
-    for (auto &logWriter : mModuleDest)
-        logWriter->setLogLevel(level);
+    for (auto &logWriter : mWriters)
+        logWriter->applyLevel(level);
+
+    // Same as writerLevelChanged for every writer, with the levels updated once
+    for (const auto entry : qAsConst(mModules))
+    {
+        if (entry->writer.load(std::memory_order_relaxed))
+            entry->level = level;
+    }
+
+    updateMinimumLevel();
 }
 
-void QLoggerManager::overwriteMaxFileSize(int maxSize)
+bool QLoggerManager::setModuleLevel(const QString &module, LogLevel level)
+{
+    QMutexLocker lock(&mMutex);
+
+    const auto entry  = mModules.value(module, nullptr);
+    const auto writer = entry ? entry->writer.load(std::memory_order_relaxed) : nullptr;
+
+    if (!writer)
+        return false;
+
+    entry->level = level;
+
+    // Same as addModule: the writer accepts the lowest level of its modules
+    if (level < writer->getLevel())
+        writer->applyLevel(level);
+
+    updateMinimumLevel();
+
+    return true;
+}
+
+void QLoggerManager::watchConfigFile(const QString &path, int interval)
+{
+    // Same as setStatsExport: the watcher may be applying a change that waits for the lock
+    std::unique_ptr<QLoggerConfigWatcher> previous;
+
+    {
+        QMutexLocker lock(&mMutex);
+        previous = std::move(mConfigWatcher);
+    }
+
+    previous.reset();
+
+    if (path.isEmpty() || interval <= 0)
+        return;
+
+    QMutexLocker lock(&mMutex);
+
+    mConfigWatcher = std::make_unique<QLoggerConfigWatcher>(path, interval, [this](const LogConfig &config) {
+        applyConfig(config);
+    });
+}
+
+void QLoggerManager::applyConfig(const LogConfig &config)
+{
+    if (config.level)
+        overwriteLogLevel(*config.level);
+
+    if (config.mode)
+        overwriteLogMode(*config.mode);
+
+    if (config.paused)
+    {
+        if (*config.paused)
+            pause();
+        else
+            resume();
+    }
+
+    for (auto iter = config.modules.cbegin(); iter != config.modules.cend(); ++iter)
+        setModuleLevel(iter.key(), iter.value());
+}
+
+void QLoggerManager::overwriteMaxFileSize(qint64 maxSize)
 {
     QMutexLocker lock(&mMutex);
 
     setDefaultMaxFileSize(maxSize);
 
-    for (auto &logWriter : mModuleDest)
+    for (auto &logWriter : mWriters)
         logWriter->setMaxFileSize(maxSize);
 }
 
-QLoggerManager::~QLoggerManager()
+bool QLoggerManager::shutdown(int timeout)
 {
-    QMutexLocker locker(&mMutex);
+    setStatsExport(0);
+    watchConfigFile(QString());
 
-    for (const auto &dest : mModuleDest.toStdMap())
-        writeAndDequeueMessages(dest.first);
+    // The reporter is stopped without the lock, its last report may be waiting for it
+    std::unique_ptr<QLoggerPeriodicJob> rateReporter;
 
-    QVector<QString> oldFiles;
+    {
+        QMutexLocker lock(&mMutex);
+        rateReporter = std::move(mRateReporter);
+    }
+
+    rateReporter.reset();
+    reportSuppressed(true);
+
+    QList<QLoggerWriter *> writers;
 
-    for (auto dest : qAsConst(mModuleDest))
     {
-        dest->closeDestination();
-        dest->terminate();
-        dest->wait();
+        QMutexLocker locker(&mMutex);
 
-        oldFiles.append(dest->getFileDestinationFolder());
+        if (mShutdown)
+            return true;
+
+        mShutdown = true;
+
+        for (const auto &dest : mModuleDest.toStdMap())
+            writeAndDequeueMessages(dest.first);
+
+        // Every destination starts draining before waiting for any of them
+        for (auto dest : qAsConst(mWriters))
+        {
+            if (dest->isActive())
+                dest->requestClose();
+            else
+                dest->closeDestination();
+        }
+
+        // No destination is added or destroyed after the shutdown: they are waited for without the lock
+        writers = mWriters.values();
     }
 
-    for (auto dest : qAsConst(mModuleDest))
+    const QDeadlineTimer deadline(timeout);
+    QList<QLoggerWriter *> late;
+
+    for (auto dest : qAsConst(writers))
     {
-        qDebug() << dest->getFileDestination() + " Done!";
+        if (!dest->waitForClosed(deadline))
+        {
+            dest->abandonClose();
+            late.append(dest);
+        }
+    }
+
+    const QDeadlineTimer grace(CLOSE_GRACE_PERIOD);
+    QList<QLoggerWriter *> leaked;
 
-        delete dest;
+    for (auto dest : qAsConst(late))
+    {
+        if (!dest->waitForClosed(grace))
+            leaked.append(dest);
     }
 
-    mModuleDest.clear();
+    QVector<QString> oldFiles;
+
+    for (auto dest : qAsConst(writers))
+    {
+        if (leaked.contains(dest))
+            continue;
+
+        if (dest->mPool)
+            mWriterPool->remove(dest);
+        else
+            dest->wait();
+
+        oldFiles.append(dest->getFileDestinationFolder());
+    }
+
+    QMutexLocker locker(&mMutex);
+
+    // The leaked destinations may still be used by their thread, and by the pool if it writes them
+    for (auto dest : qAsConst(leaked))
+    {
+        mWriters.remove(mWriters.key(dest));
+        mLeakWriterPool = mLeakWriterPool || dest->mPool;
+    }
 
     if (!mNewLogsFolder.isEmpty() && mNewLogsFolder != mDefaultFileDestinationFolder)
     {
@@ -285,6 +954,26 @@ QLoggerManager::~QLoggerManager()
             }
         }
     }
+
+    return late.isEmpty();
+}
+
+QLoggerManager::~QLoggerManager()
+{
+    shutdown();
+
+    QMutexLocker locker(&mMutex);
+
+    qDeleteAll(mWriters);
+
+    mWriters.clear();
+    mModuleDest.clear();
+
+    qDeleteAll(mModules);
+    mModules.clear();
+
+    if (mLeakWriterPool)
+        mWriterPool.release();
 }
 
 }  // namespace QLogger
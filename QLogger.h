@@ -22,15 +22,31 @@
  ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  ***************************************************************************************/
 
+#include <QLoggerConfig.h>
 #include <QLoggerLevel.h>
+#include <QLoggerPeriodicJob.h>
+#include <QLoggerRecord.h>
+#include <QLoggerRetention.h>
+#include <QLoggerSink.h>
+#include <QLoggerSnapshot.h>
+#include <QLoggerStats.h>
+#include <QLoggerWriterPool.h>
+#include <QHash>
 #include <QMap>
 #include <QMutex>
+#include <QSet>
 #include <QVariant>
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+
 namespace QLogger
 {
 
 class QLoggerWriter;
+class ModuleHandle;
 
 /**
  * @brief The QLoggerManager class manages the different destination files that we would like to have.
@@ -48,7 +64,8 @@ public:
     * @brief This method creates a QLoogerWriter that stores the name of the file and the log
     * level assigned to it. Here is added to the map the different modules assigned to each
     * log file. The method returns <em>false</em> if a module is configured to be stored in
-    * more than one file.
+    * more than one file. Modules stored in the same file share one QLoggerWriter: the first module
+    * added to a file sets its mode, file suffix and message options, the level is kept per module.
     *
     * @param fileDest The file name and path to print logs.
     * @param module The module that will be stored in the file.
@@ -64,7 +81,8 @@ public:
     * @brief This method creates a QLoogerWriter that stores the name of the file and the log
     * level assigned to it. Here is added to the map the different modules assigned to each
     * log file. The method returns <em>false</em> if a module is configured to be stored in
-    * more than one file.
+    * more than one file. Modules stored in the same file share one QLoggerWriter: the first module
+    * added to a file sets its mode, file suffix and message options, the level is kept per module.
     *
     * @param fileDest The file name and path to print logs.
     * @param modules The modules that will be stored in the file.
@@ -77,7 +95,8 @@ public:
     */
     bool addDestination(const QString &fileDest, const QStringList &modules, LogLevel level = LogLevel::Warning, const QString &fileFolderDestination = QString(), LogMode mode = LogMode::OnlyFile, LogFileDisplay fileSuffixIfFull = LogFileDisplay::DateTime, LogMessageDisplays messageOptions = LogMessageDisplay::Default, bool notify = true);
     /**
-    * @brief Clears old log files from the current storage folder.
+    * @brief Clears old log files from the current storage folder. The files are deleted in the background by
+    * QLoggerRetention, the call doesn't wait for them. setRetention limits the rotated files as they are created.
     *
     * @param fileFolderDestination The destination folder.
     * @param days Minimum age of log files to delete. Logs older than
@@ -85,7 +104,16 @@ public:
     */
     static void clearFileDestinationFolder(const QString &fileFolderDestination, int days, const QStringList &listFilter);
     /**
-    * @brief enqueueMessage Enqueues a message in the corresponding QLoggerWritter.
+    * @brief addSink Adds an output to the destination of a module, next to its file and console, like a
+    * QLoggerNetworkSink. The other modules of the same file use it too.
+    * @param module A module with a destination.
+    * @param sink The output. It can be added to several destinations.
+    * @return False if the module has no destination.
+    */
+    bool addSink(const QString &module, std::shared_ptr<QLoggerSink> sink);
+    /**
+    * @brief enqueueMessage Enqueues a message in the corresponding QLoggerWritter. The module lookup is done in an
+    * immutable snapshot of the modules so the call doesn't take any lock for modules that have a destination.
     * @param module The module that writes the message.
     * @param level The level of the message.
     * @param message The message to log.
@@ -94,6 +122,82 @@ public:
     * @param line The line in the file where the log comes from.
     */
     void enqueueMessage(const QString &module, LogLevel level, const QString &message, const QString &function, const QString &file, int line);
+    /**
+    * @brief enqueueMessage Enqueues a message logged by one of the QLog_* macros.
+    * @param module The module that writes the message.
+    * @param site The call site of the message, with its level. It must live as long as the QLoggerManager.
+    * @param message The message to log.
+    * @param fields The fields of a structured message. They are formatted by the writer.
+    */
+    void enqueueMessage(const QString &module, const LogCallSite *site, const QString &message, LogFields fields = LogFields());
+
+    /**
+    * @brief module Gets a handle of the module for the QLog_*H macros. Logging with it skips the lookup of the module
+    * by name. The handle can be taken before the destination of the module is added and stays valid as long as the
+    * QLoggerManager.
+    * @param module The name of the module.
+    */
+    ModuleHandle module(const QString &module);
+
+    /**
+    * @brief enqueueMessage Enqueues a message of the module of the handle.
+    * @param module The handle of the module. Nothing is done if it is not valid.
+    * @param site The call site of the message, with its level. It must live as long as the QLoggerManager.
+    * @param message The message to log.
+    * @param fields The fields of a structured message. They are formatted by the writer.
+    */
+    void enqueueMessage(const ModuleHandle &module, const LogCallSite *site, const QString &message, LogFields fields = LogFields());
+
+    /**
+    * @brief isEnabled Checks without locking if a message would be written. It is used by the QLog_* macros before
+    * the message is built. Messages of modules without destination pass the check if their level is at least the
+    * lowest level in use, so they can be written once the destination is added.
+    * @param module The module that writes the message.
+    * @param level The level of the message.
+    * @return True if the message has to be enqueued.
+    */
+    bool isEnabled(const QString &module, LogLevel level) const
+    {
+        return static_cast<int>(level) >= mMinimumLevel.load(std::memory_order_relaxed) && isModuleEnabled(module, level);
+    }
+
+    /**
+    * @brief isEnabled Checks the level of a call site like isEnabled(module, level) and takes a message from the
+    * budget of its rate limit, if the module has one. It is used by the QLog_* macros, so suppressed messages are not
+    * built.
+    * @param module The module that writes the message.
+    * @param site The call site of the message.
+    * @return True if the message has to be enqueued.
+    */
+    bool isEnabled(const QString &module, const LogCallSite *site)
+    {
+        return static_cast<int>(site->level) >= mMinimumLevel.load(std::memory_order_relaxed) && isModuleEnabled(module, site);
+    }
+
+    /**
+    * @brief setRateLimit Limits the messages of a level of a module. Above the limit the messages are suppressed and
+    * counted. Their number is written before the next message allowed or, if the messages stop, once the budget is
+    * full again, and by flushAll and when the manager is destroyed. The module doesn't need a destination yet.
+    * @param module The module.
+    * @param level The level of the messages limited.
+    * @param messagesPerSecond The rate of messages allowed, 0 to remove the limit.
+    * @param burst The number of messages allowed at once.
+    * @param scope Whether every call site has its own budget or the module shares one.
+    */
+    void setRateLimit(const QString &module, LogLevel level, int messagesPerSecond, int burst = 10, LogRateScope scope = LogRateScope::CallSite);
+
+    /**
+    * @brief updateMinimumLevel Recomputes the lowest level written by any destination. It is called whenever the
+    * level, the mode or the stop state of a destination changes.
+    */
+    void updateMinimumLevel();
+
+    /**
+    * @brief writerLevelChanged Gives the new level of a destination to all the modules that log in it. It is called
+    * by QLoggerWriter::setLogLevel.
+    * @param writer The destination whose level changed.
+    */
+    void writerLevelChanged(QLoggerWriter *writer);
 
     /**
     * @brief Whether the QLogger is paused or not.
@@ -110,6 +214,37 @@ public:
     */
     void resume();
 
+    /**
+    * @brief shutdown Writes what is left in every destination and closes them. All the destinations are drained at
+    * the same time and their threads end by themselves. Then the logs are moved if moveLogsWhenClose was called. The
+    * destructor calls it, the messages logged afterwards and the new destinations are discarded.
+    * @param timeout The milliseconds to wait for the queues to be written. When it expires the destinations stop
+    * after the batch they are writing and the messages left are counted as dropped. A destination still writing its
+    * batch a second later is left to its thread and never deleted, so the shutdown doesn't hang on it.
+    * @return True if every message was written before the timeout.
+    */
+    bool shutdown(int timeout = 10000);
+
+    /**
+    * @brief flushAll Blocks until the messages enqueued in all the QLoggerWriters before the call are written and the
+    * files are synced to the disk.
+    */
+    void flushAll();
+
+    /**
+    * @brief stats Gets the counters of all the destinations and of the compression of the rotated files.
+    */
+    LogStats stats() const;
+
+    /**
+    * @brief setStatsExport Exports the stats periodically from a thread of its own.
+    * @param interval The milliseconds between two exports, 0 to stop exporting.
+    * @param format The format of the export.
+    * @param target With LogStatsFormat::Text, the module that logs the stats. With LogStatsFormat::Prometheus, the
+    * path of the file.
+    */
+    void setStatsExport(int interval, LogStatsFormat format = LogStatsFormat::Text, const QString &target = QStringLiteral("QLogger"));
+
     /**
     * @brief getDefaultFileDestinationFolder Gets the default file destination folder.
     * @return The file destination folder
@@ -135,11 +270,96 @@ public:
     void setDefaultFileDestination(const QString &fileDestination) { mDefaultFileDestination = fileDestination; }
     void setDefaultFileSuffixIfFull(LogFileDisplay fileSuffixIfFull) { mDefaultFileSuffixIfFull = fileSuffixIfFull; }
 
-    void setDefaultLevel(LogLevel level) { mDefaultLevel = level; }
+    void setDefaultLevel(LogLevel level);
     void setDefaultMode(LogMode mode) { mDefaultMode = mode; }
-    void setDefaultMaxFileSize(int maxFileSize) { mDefaultMaxFileSize = maxFileSize; }
+    void setDefaultMaxFileSize(qint64 maxFileSize) { mDefaultMaxFileSize = maxFileSize; }
     void setDefaultMessageOptions(LogMessageDisplays messageOptions) { mDefaultMessageOptions = messageOptions; }
 
+    /**
+    * @brief Sets the default limits of the queue of each destination and what happens when it is full. The destinations
+    * added afterwards use them. Dropped messages are counted and written in the destination with the next batch.
+    *
+    * @param maxMessages The maximum number of messages waiting to be written.
+    * @param maxBytes The maximum memory used by the messages waiting to be written, 0 for no limit.
+    */
+    void setDefaultQueueCapacity(int maxMessages, qint64 maxBytes = 0)
+    {
+        mDefaultQueueCapacity = maxMessages;
+        mDefaultQueueMaxBytes = maxBytes;
+    }
+    /**
+    * @brief Sets the default flush policy of the destinations added afterwards. See QLoggerWriter::setFlushPolicy.
+    */
+    void setDefaultFlushPolicy(int maxLatency, int batchMessages = 1024, qint64 batchBytes = 1024 * 1024)
+    {
+        mDefaultFlushLatency       = maxLatency;
+        mDefaultFlushBatchMessages = batchMessages;
+        mDefaultFlushBatchBytes    = batchBytes;
+    }
+    /**
+    * @brief Sets the format of the files of the destinations added afterwards.
+    */
+    void setDefaultFormat(LogFormat format) { mDefaultFormat = format; }
+    /**
+    * @brief Sets if the destinations added afterwards escape the control characters of their text lines, so every
+    * message stays on one line. See QLoggerWriter::setEscaping.
+    */
+    void setDefaultEscaping(bool escape) { mDefaultEscaping = escape; }
+    /**
+    * @brief Sets the size of the ring file of the destinations added afterwards in LogMode::MemoryMapped.
+    */
+    void setDefaultRingSize(qint64 size) { mDefaultRingSize = size; }
+    /**
+    * @brief Sets how many messages of a module are kept until its destination is added. The newer ones are discarded.
+    */
+    void setPreRegistrationLimit(int messages);
+    /**
+    * @brief Sets the default durability of the destinations added afterwards. See QLoggerWriter::setDurability.
+    */
+    void setDefaultDurability(LogLevel flushLevel, int syncInterval = -1)
+    {
+        mDefaultFlushLevel   = flushLevel;
+        mDefaultSyncInterval = syncInterval;
+    }
+    /**
+    * @brief Sets how the rotated files of the destinations added afterwards are compressed.
+    */
+    void setDefaultCompression(LogCompression compression, int level = 9)
+    {
+        mDefaultCompression      = compression;
+        mDefaultCompressionLevel = level;
+    }
+    /**
+    * @brief Sets the limits of the rotated files of the destinations added afterwards. See LogRetention.
+    */
+    void setDefaultRetention(const LogRetention &retention) { mDefaultRetention = retention; }
+    /**
+    * @brief Sets the limits of the rotated files of the destination of a module. The files rotated before are found
+    * once in the background, then the files over the limits are deleted as the destination rotates.
+    * @return False if the module has no destination.
+    */
+    bool setRetention(const QString &module, const LogRetention &retention);
+    /**
+    * @brief Sets how many rotated files are compressed at the same time in the background.
+    */
+    void setCompressionThreads(int threads);
+    /**
+    * @brief Sets the number of threads shared by the destinations to write their queues, 2 by default. With 0 the
+    * destinations added afterwards get a thread of their own, as in previous versions.
+    */
+    void setWriterThreads(int threads);
+    /**
+    * @brief Sets whether the console lines of LogMode::OnlyConsole and LogMode::Full are colored by level with ANSI
+    * escape codes. The lines of LogLevel::Warning and above go to the standard error.
+    */
+    void setConsoleColors(bool colors);
+
+    void setDefaultOverflowPolicy(LogOverflowPolicy policy, int sampleRate = 10)
+    {
+        mDefaultOverflowPolicy = policy;
+        mDefaultSampleRate     = sampleRate;
+    }
+
     /**
     * @brief overwriteLogMode Overwrites the logging mode in all the destinations. Sets the default logging mode.
     *
@@ -153,12 +373,30 @@ public:
     */
     void overwriteLogLevel(LogLevel level);
     /**
+    * @brief setModuleLevel Changes the level of one module, i.e. to Trace during an incident, without changing the
+    * other modules of its destination. The producers are not stopped while it is applied.
+    *
+    * @param module The module. It must have a destination.
+    * @param level The new log level
+    * @return False if the module has no destination.
+    */
+    bool setModuleLevel(const QString &module, LogLevel level);
+    /**
+    * @brief watchConfigFile Applies the settings of a file, in INI format, when it is modified:
+    * level, mode and paused in [General] for all the destinations, and one key per module in [modules] with its level.
+    * The file is polled from a thread of its own and only the keys present are applied.
+    *
+    * @param path The file, empty to stop watching.
+    * @param interval The milliseconds between two checks of the file.
+    */
+    void watchConfigFile(const QString &path, int interval = 1000);
+    /**
     * @brief overwriteMaxFileSize Overwrites the maximum file size in all the destinations. Sets the default max file
     * size.
     *
-    * @param maxSize The new file size
+    * @param maxSize The new file size, 0 to rotate only when the day changes.
     */
-    void overwriteMaxFileSize(int maxSize);
+    void overwriteMaxFileSize(qint64 maxSize);
 
     /**
     * @brief moveLogsWhenClose Moves all the logs to a new folder. This will happen only on close.
@@ -173,17 +411,125 @@ private:
     /**
     * @brief Checks if the logger is stop
     */
-    bool mIsStop = false;
+    std::atomic<bool> mIsStop { false };
+
+    /**
+    * @brief Whether shutdown was called.
+    */
+    bool mShutdown = false;
+
+    /**
+    * @brief Milliseconds that shutdown gives to the batch in progress of a destination once its timeout has expired.
+    * The destinations still writing afterwards, as one blocked on a file system that doesn't answer, are leaked.
+    */
+    static constexpr int CLOSE_GRACE_PERIOD = 1000;
 
     /**
     * @brief Map that stores the module and the file it is assigned.
     */
     QMap<QString, QLoggerWriter *> mModuleDest;
 
+    friend class ModuleHandle;
+
+    /**
+    * @brief Module known by the manager. The name is referenced by the records and the handles of the module so the
+    * entries are only deleted with the QLoggerManager. An entry created by module() has no writer until the
+    * destination of the module is added.
+    */
+    struct Module
+    {
+        QString name;
+        std::atomic<QLoggerWriter *> writer { nullptr };
+        LogLevel level = LogLevel::Warning;
+
+        /**
+        * @brief Lowest level written for the module: its own level if the destination is enabled, the default level
+        * while it has no destination.
+        */
+        std::atomic<int> enabledLevel { DISABLED_LEVEL };
+
+        bool isEnabled(LogLevel messageLevel) const
+        {
+            return static_cast<int>(messageLevel) >= enabledLevel.load(std::memory_order_relaxed);
+        }
+
+        /**
+        * @brief Rate limit of a level. The budget of the module is used by the messages without call site.
+        */
+        struct RateLimit
+        {
+            /**
+            * @brief Ticks between two messages at the allowed rate, 0 without limit.
+            */
+            std::atomic<qint64> interval { 0 };
+            /**
+            * @brief Ticks a budget can go ahead of the current time: the burst minus one message.
+            */
+            std::atomic<qint64> tolerance { 0 };
+            std::atomic<bool> perCallSite { true };
+            LogRateState moduleRate;
+        };
+
+        mutable std::array<RateLimit, static_cast<int>(LogLevel::Fatal) + 1> rateLimits;
+    };
+    QHash<QString, Module *> mModules;
+
+    /**
+    * @brief Writers by file destination. Modules that log in the same file share the writer.
+    */
+    QHash<QString, QLoggerWriter *> mWriters;
+
+    /**
+    * @brief Immutable copy of mModules read by enqueueMessage without locking. It is replaced every time a
+    * destination is added, and the replaced copies are deleted by the next one once no producer reads them.
+    */
+    using ModuleSnapshot = QHash<QString, const Module *>;
+    QLoggerSnapshot<ModuleSnapshot> mModuleSnapshot;
+
+    /**
+    * @brief Lowest level written by any destination or by the default level. Messages below it are discarded by
+    * the QLog_* macros without looking up the module.
+    */
+    std::atomic<int> mMinimumLevel { static_cast<int>(LogLevel::Warning) };
+
     /**
-    * @brief Defines the queue of messages when no writers have been set yet.
+    * @brief Interned UTF-8 copies of the function and file names given as QString. They have a mutex of their own, so
+    * logging with the QString API doesn't wait for a change of the settings.
     */
-    QMultiMap<QString, QVector<QVariant>> mNonWriterQueue;
+    QMutex mInternMutex;
+    QSet<QByteArray> mInternedStrings;
+    /**
+    * @brief Call site of the messages given with the function and file as QString, with the texts it was interned
+    * from. The sites with the same hash are chained by next.
+    */
+    struct InternedSite
+    {
+        QString function;
+        QString file;
+        LogCallSite site;
+        const InternedSite *next = nullptr;
+
+        bool matches(const QString &otherFunction, const QString &otherFile, int line, LogLevel level) const
+        {
+            return site.line == line && site.level == level && function == otherFunction && file == otherFile;
+        }
+    };
+    /**
+    * @brief The deques keep the addresses of the sites and of their rate states. The index is only read with
+    * mInternMutex; mSiteCache keeps the last site of each slot, so the sites already interned are found without
+    * locking nor allocating.
+    */
+    std::deque<InternedSite> mInternedSites;
+    std::deque<LogRateState> mInternedRates;
+    QHash<size_t, const InternedSite *> mInternedSiteIndex;
+    std::array<std::atomic<const InternedSite *>, 256> mSiteCache {};
+
+    /**
+    * @brief Records of the modules that have no destination yet. They are moved to the writer once, when the
+    * destination of the module is added, so the normal path never looks at them.
+    */
+    QHash<QString, QVector<LogRecord>> mPendingRecords;
+    int mPreRegistrationLimit = 100;
 
     /**
     * @brief Default values for QLoggerWritter parameters. Useful for multiple QLoggerWritter.
@@ -195,19 +541,60 @@ private:
     LogMode mDefaultMode   = LogMode::OnlyFile;
     LogLevel mDefaultLevel = LogLevel::Warning;
 
-    int mDefaultMaxFileSize                   = 1024 * 1024;  //! @note 1Mio
+    qint64 mDefaultMaxFileSize                = 512 * 1024 * 1024;  //! @note 512Mio
     LogMessageDisplays mDefaultMessageOptions = LogMessageDisplay::Default;
+    int mDefaultQueueCapacity                 = 8192;
+    qint64 mDefaultQueueMaxBytes              = 0;
+    LogOverflowPolicy mDefaultOverflowPolicy  = LogOverflowPolicy::Block;
+    int mDefaultSampleRate                    = 10;
+    LogCompression mDefaultCompression        = LogCompression::SevenZip;
+    int mDefaultFlushLatency                  = 500;
+    LogLevel mDefaultFlushLevel               = LogLevel::Fatal;
+    qint64 mDefaultRingSize                   = 16 * 1024 * 1024;
+    LogFormat mDefaultFormat                  = LogFormat::Text;
+    bool mDefaultEscaping                     = false;
+    int mDefaultSyncInterval                  = -1;
+    int mDefaultFlushBatchMessages            = 1024;
+    qint64 mDefaultFlushBatchBytes            = 1024 * 1024;
+    int mDefaultCompressionLevel              = 9;
+    LogRetention mDefaultRetention;
+    int mWriterThreads                        = 2;
     QString mNewLogsFolder;
 
+    /**
+    * @brief Threads that write the queues of the destinations. They are started by the first destination. It is leaked
+    * if shutdown leaks a destination that it writes.
+    */
+    std::unique_ptr<QLoggerWriterPool> mWriterPool = std::make_unique<QLoggerWriterPool>();
+    bool mLeakWriterPool = false;
+
+    std::unique_ptr<QLoggerPeriodicJob> mStatsExporter;
+
+    /**
+    * @brief The rate limit budgets that have suppressed messages not reported yet. A budget is added by its first
+    * suppressed message and checked periodically by mRateReporter, which is started by the first rate limit.
+    */
+    struct SuppressedRate
+    {
+        const Module *entry;
+        const LogCallSite *site;
+        LogRateState *rate;
+        bool perCallSite;
+    };
+    QMutex mRateMutex;
+    QVector<SuppressedRate> mSuppressedRates;
+    std::unique_ptr<QLoggerPeriodicJob> mRateReporter;
+    std::unique_ptr<QLoggerConfigWatcher> mConfigWatcher;
+
     /**
     * @brief Mutex to make the method thread-safe.
     */
-    QRecursiveMutex mMutex;
+    mutable QRecursiveMutex mMutex;
 
     /**
-    * @brief Default builder of the class. It starts the thread.
+    * @brief Default builder of the class.
     */
-    QLoggerManager() = default;
+    QLoggerManager();
 
     /**
     * @brief Destructor
@@ -215,7 +602,8 @@ private:
     ~QLoggerManager();
 
     /**
-    * @brief Initializes and returns a new instance of QLoggerWriter with the given parameters.
+    * @brief Initializes and returns a new instance of QLoggerWriter with the given parameters. If a writer already
+    * logs in the same file, that one is returned and the other parameters are ignored.
     * @param fileDest The file name and path to print logs.
     * @param level The maximum level allowed.
     * @param fileFolderDestination The complete folder destination.
@@ -224,18 +612,148 @@ private:
     * @param messageOptions Specifies what elements are displayed in one line of log message.
     * @return the newly created QLoggerWriter instance.
     */
-    QLoggerWriter *createWriter(const QString &fileDest, LogLevel level, const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions) const;
+    QLoggerWriter *createWriter(const QString &fileDest, LogLevel level, const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions);
+
+    /**
+    * @brief Gets the default level for LogLevel::Warning, which is the default argument of addDestination.
+    */
+    LogLevel levelOrDefault(LogLevel level) const;
 
     void startWriter(const QString &module, QLoggerWriter *log, LogMode mode, bool notify);
 
     /**
-    * @brief Checks the queue and writes the messages if the writer is the correct one. The queue is emptied
-    * for that module.
+    * @brief Registers the destination of a module.
+    */
+    void addModule(const QString &module, QLoggerWriter *log, LogLevel level, LogMode mode, bool notify);
+
+    /**
+    * @brief Gets a UTF-8 copy of the text that lives as long as the QLoggerManager.
+    */
+    const char *internString(const QString &text);
+
+    /**
+    * @brief Same as internString, when mMutex is already locked.
+    */
+    const char *internStringLocked(const QString &text);
+
+    /**
+    * @brief Gets a call site that lives as long as the QLoggerManager. The folders of the file are removed.
+    */
+    const LogCallSite *internSite(const QString &function, const QString &file, int line, LogLevel level);
+
+    /**
+    * @brief Applies the settings read by the QLoggerConfigWatcher.
+    */
+    void applyConfig(const LogConfig &config);
+
+    /**
+    * @brief Publishes a new snapshot of mModules for the lock-free lookup in enqueueMessage.
+    */
+    void publishModules();
+
+    /**
+    * @brief Checks the level of the message against the destination of the module.
+    */
+    bool isModuleEnabled(const QString &module, LogLevel level) const;
+
+    /**
+    * @brief Checks the level of the call site against the destination of the module and its rate limit.
+    */
+    bool isModuleEnabled(const QString &module, const LogCallSite *site);
+
+    /**
+    * @brief Takes a message from the budget of the rate limit of the call site. When the budget allows a message after
+    * some were suppressed, a message with their number is enqueued first.
+    * @return False if the message has to be suppressed.
+    */
+    bool acquireRate(const Module *entry, const LogCallSite *site);
+
+    /**
+    * @brief Enqueues the number of messages suppressed by a budget of a rate limit.
+    */
+    void enqueueSuppressed(const Module *entry, const LogCallSite *site, LogLevel level, quint64 suppressed, qint64 timestamp);
+
+    /**
+    * @brief Reports the messages suppressed by the budgets that are full again, or by all of them.
+    * @param all True to report every budget without waiting for it to be full, as flushAll and the destructor do.
+    */
+    void reportSuppressed(bool all);
+
+    /**
+    * @brief Gets the entry of the module, creating it without writer if it doesn't exist.
+    */
+    Module *moduleEntry(const QString &module);
+
+    /**
+    * @brief Looks up the entry of the module in mModuleSnapshot without locking. The entries live as long as the
+    * manager, only the snapshot has to be pinned during the lookup.
+    * @return The entry of the module, null if it has no destination.
+    */
+    const Module *findModule(const QString &module) const;
+
+    /**
+    * @brief Enqueues the record in the writer of the module or keeps it until the module has a destination.
+    */
+    void enqueueRecord(const Module *entry, LogRecord &&record);
+
+    /**
+    * @brief Stores the record of a module without destination. The record is written when the destination
+    * of the module is added.
+    */
+    void enqueueNonWriterMessage(const QString &module, LogRecord &&record);
+
+    /**
+    * @brief Moves the pending records of the module to its writer. Nothing is done while the writer is stop: the
+    * records wait for resume().
     * @param module The module to dequeue the messages from
     */
     void writeAndDequeueMessages(const QString &module);
 };
 
+/**
+ * @brief The ModuleHandle class references a module of the QLoggerManager. It is a pointer to the entry of the
+ * module, which holds its writer and its level, so checking the level and logging don't look up the module name.
+ */
+class ModuleHandle
+{
+public:
+    ModuleHandle() = default;
+
+    /**
+    * @brief isValid Whether the handle references a module.
+    */
+    bool isValid() const { return mModule != nullptr; }
+
+    /**
+    * @brief name Gets the name of the module.
+    */
+    QString name() const { return mModule ? mModule->name : QString(); }
+
+    /**
+    * @brief isEnabled Checks without locking if a message of the module would be written.
+    */
+    bool isEnabled(LogLevel level) const { return mModule && mModule->isEnabled(level); }
+
+    /**
+    * @brief isEnabled Checks the level of the call site and takes a message from the budget of the rate limit of the
+    * module, if it has one.
+    */
+    bool isEnabled(const LogCallSite *site) const
+    {
+        return mModule && mModule->isEnabled(site->level) && QLoggerManager::getInstance()->acquireRate(mModule, site);
+    }
+
+private:
+    friend class QLoggerManager;
+
+    explicit ModuleHandle(const QLoggerManager::Module *module)
+        : mModule(module)
+    {
+    }
+
+    const QLoggerManager::Module *mModule = nullptr;
+};
+
 /**
  * @brief Here is done the call to write the message in the module. First of all is confirmed
  * that the log level we want to write is less or equal to the level defined when we create the
@@ -252,14 +770,78 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
 
 }  // namespace QLogger
 
+/**
+ * @brief The values of the LogCallSite of the line that expands the macro. The file name is taken out of __FILE__ when
+ * compiling.
+ */
+#define QLOGGER_CALL_SITE(level) __FUNCTION__, QLogger::fileBaseName(__FILE__), __LINE__, level
+
+/**
+ * @brief Checks the level before building the message and enqueues it in the destination of the module. The message
+ * argument is not evaluated if the message is discarded; the module argument is evaluated once. Levels below
+ * QLOGGER_MIN_LEVEL are removed at compile time. It is a statement, it can't be used as an expression.
+ * @param module The module that the message references.
+ * @param level The level of the message.
+ * @param message The message.
+ */
+#define QLOGGER_LOG_MESSAGE(module, level, message)                                                              \
+    do                                                                                                           \
+    {                                                                                                            \
+        if constexpr (QLogger::isCompiledLevel(level))                                                           \
+        {                                                                                                        \
+            static QLogger::LogRateState qloggerRate;                                                            \
+            static constexpr QLogger::LogCallSite qloggerSite { QLOGGER_CALL_SITE(level), &qloggerRate };        \
+            const QString &qloggerModule = (module);                                                             \
+            const auto qloggerManager    = QLogger::QLoggerManager::getInstance();                               \
+            if (qloggerManager->isEnabled(qloggerModule, &qloggerSite))                                          \
+                qloggerManager->enqueueMessage(qloggerModule, &qloggerSite, message);                            \
+        }                                                                                                        \
+    } while (false)
+
+/**
+ * @brief Logs a structured message: the values are captured as they are and formatted by the writer, as text or as
+ * JSON with LogMessageDisplay::Json. As QLOGGER_LOG_MESSAGE, the module is evaluated once and the message and the
+ * fields are not evaluated if the message is discarded.
+ */
+#define QLOGGER_LOG_FIELDS(module, level, message, ...)                                                          \
+    do                                                                                                           \
+    {                                                                                                            \
+        if constexpr (QLogger::isCompiledLevel(level))                                                           \
+        {                                                                                                        \
+            static QLogger::LogRateState qloggerRate;                                                            \
+            static constexpr QLogger::LogCallSite qloggerSite { QLOGGER_CALL_SITE(level), &qloggerRate };        \
+            const QString &qloggerModule = (module);                                                             \
+            const auto qloggerManager    = QLogger::QLoggerManager::getInstance();                               \
+            if (qloggerManager->isEnabled(qloggerModule, &qloggerSite))                                          \
+                qloggerManager->enqueueMessage(qloggerModule, &qloggerSite, message,                             \
+                                               QLogger::makeFields(__VA_ARGS__));                                \
+        }                                                                                                        \
+    } while (false)
+
+/**
+ * @brief Logs a message with a ModuleHandle instead of the module name. As QLOGGER_LOG_MESSAGE, the handle is
+ * evaluated once and the message is not evaluated if it is discarded.
+ */
+#define QLOGGER_LOG_HANDLE(handle, level, message)                                                               \
+    do                                                                                                           \
+    {                                                                                                            \
+        if constexpr (QLogger::isCompiledLevel(level))                                                           \
+        {                                                                                                        \
+            static QLogger::LogRateState qloggerRate;                                                            \
+            static constexpr QLogger::LogCallSite qloggerSite { QLOGGER_CALL_SITE(level), &qloggerRate };        \
+            const QLogger::ModuleHandle &qloggerHandle = (handle);                                               \
+            if (qloggerHandle.isEnabled(&qloggerSite))                                                           \
+                QLogger::QLoggerManager::getInstance()->enqueueMessage(qloggerHandle, &qloggerSite, message);    \
+        }                                                                                                        \
+    } while (false)
+
 #ifndef QLog_Trace
 /**
  * @brief Used to store Trace level messages.
  * @param module The module that the message references.
  * @param message The message.
  */
-#    define QLog_Trace(module, message) \
-        QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Trace, message, __FUNCTION__, __FILE__, __LINE__)
+#    define QLog_Trace(module, message) QLOGGER_LOG_MESSAGE(module, QLogger::LogLevel::Trace, message)
 #endif
 
 #ifndef QLog_Debug
@@ -268,8 +850,7 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#    define QLog_Debug(module, message) \
-        QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Debug, message, __FUNCTION__, __FILE__, __LINE__)
+#    define QLog_Debug(module, message) QLOGGER_LOG_MESSAGE(module, QLogger::LogLevel::Debug, message)
 #endif
 
 #ifndef QLog_Info
@@ -278,8 +859,7 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#    define QLog_Info(module, message) \
-        QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Info, message, __FUNCTION__, __FILE__, __LINE__)
+#    define QLog_Info(module, message) QLOGGER_LOG_MESSAGE(module, QLogger::LogLevel::Info, message)
 #endif
 
 #ifndef QLog_Warning
@@ -288,8 +868,7 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#    define QLog_Warning(module, message) \
-        QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Warning, message, __FUNCTION__, __FILE__, __LINE__)
+#    define QLog_Warning(module, message) QLOGGER_LOG_MESSAGE(module, QLogger::LogLevel::Warning, message)
 #endif
 
 #ifndef QLog_Error
@@ -298,8 +877,7 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#    define QLog_Error(module, message) \
-        QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Error, message, __FUNCTION__, __FILE__, __LINE__)
+#    define QLog_Error(module, message) QLOGGER_LOG_MESSAGE(module, QLogger::LogLevel::Error, message)
 #endif
 
 #ifndef QLog_Fatal
@@ -308,6 +886,119 @@ extern void QLog_(const QString &module, QLogger::LogLevel level, const QString
  * @param module The module that the message references.
  * @param message The message.
  */
-#    define QLog_Fatal(module, message) \
-        QLogger::QLoggerManager::getInstance()->enqueueMessage(module, QLogger::LogLevel::Fatal, message, __FUNCTION__, __FILE__, __LINE__)
+#    define QLog_Fatal(module, message) QLOGGER_LOG_MESSAGE(module, QLogger::LogLevel::Fatal, message)
+#endif
+
+#ifndef QLog_TraceKV
+/**
+ * @brief Used to store Trace level structured messages.
+ * @param module The module that the message references.
+ * @param message The message.
+ * @param ... Pairs of key and value, i.e. "latency_us", latency, "status", status.
+ */
+#    define QLog_TraceKV(module, message, ...) QLOGGER_LOG_FIELDS(module, QLogger::LogLevel::Trace, message, __VA_ARGS__)
+#endif
+
+#ifndef QLog_DebugKV
+/**
+ * @brief Used to store Debug level structured messages.
+ * @param module The module that the message references.
+ * @param message The message.
+ * @param ... Pairs of key and value, i.e. "latency_us", latency, "status", status.
+ */
+#    define QLog_DebugKV(module, message, ...) QLOGGER_LOG_FIELDS(module, QLogger::LogLevel::Debug, message, __VA_ARGS__)
+#endif
+
+#ifndef QLog_InfoKV
+/**
+ * @brief Used to store Info level structured messages.
+ * @param module The module that the message references.
+ * @param message The message.
+ * @param ... Pairs of key and value, i.e. "latency_us", latency, "status", status.
+ */
+#    define QLog_InfoKV(module, message, ...) QLOGGER_LOG_FIELDS(module, QLogger::LogLevel::Info, message, __VA_ARGS__)
+#endif
+
+#ifndef QLog_WarningKV
+/**
+ * @brief Used to store Warning level structured messages.
+ * @param module The module that the message references.
+ * @param message The message.
+ * @param ... Pairs of key and value, i.e. "latency_us", latency, "status", status.
+ */
+#    define QLog_WarningKV(module, message, ...) QLOGGER_LOG_FIELDS(module, QLogger::LogLevel::Warning, message, __VA_ARGS__)
+#endif
+
+#ifndef QLog_ErrorKV
+/**
+ * @brief Used to store Error level structured messages.
+ * @param module The module that the message references.
+ * @param message The message.
+ * @param ... Pairs of key and value, i.e. "latency_us", latency, "status", status.
+ */
+#    define QLog_ErrorKV(module, message, ...) QLOGGER_LOG_FIELDS(module, QLogger::LogLevel::Error, message, __VA_ARGS__)
+#endif
+
+#ifndef QLog_FatalKV
+/**
+ * @brief Used to store Fatal level structured messages.
+ * @param module The module that the message references.
+ * @param message The message.
+ * @param ... Pairs of key and value, i.e. "latency_us", latency, "status", status.
+ */
+#    define QLog_FatalKV(module, message, ...) QLOGGER_LOG_FIELDS(module, QLogger::LogLevel::Fatal, message, __VA_ARGS__)
+#endif
+
+#ifndef QLog_TraceH
+/**
+ * @brief Used to store Trace level messages with a module handle.
+ * @param handle The ModuleHandle given by QLoggerManager::module.
+ * @param message The message.
+ */
+#    define QLog_TraceH(handle, message) QLOGGER_LOG_HANDLE(handle, QLogger::LogLevel::Trace, message)
+#endif
+
+#ifndef QLog_DebugH
+/**
+ * @brief Used to store Debug level messages with a module handle.
+ * @param handle The ModuleHandle given by QLoggerManager::module.
+ * @param message The message.
+ */
+#    define QLog_DebugH(handle, message) QLOGGER_LOG_HANDLE(handle, QLogger::LogLevel::Debug, message)
+#endif
+
+#ifndef QLog_InfoH
+/**
+ * @brief Used to store Info level messages with a module handle.
+ * @param handle The ModuleHandle given by QLoggerManager::module.
+ * @param message The message.
+ */
+#    define QLog_InfoH(handle, message) QLOGGER_LOG_HANDLE(handle, QLogger::LogLevel::Info, message)
+#endif
+
+#ifndef QLog_WarningH
+/**
+ * @brief Used to store Warning level messages with a module handle.
+ * @param handle The ModuleHandle given by QLoggerManager::module.
+ * @param message The message.
+ */
+#    define QLog_WarningH(handle, message) QLOGGER_LOG_HANDLE(handle, QLogger::LogLevel::Warning, message)
+#endif
+
+#ifndef QLog_ErrorH
+/**
+ * @brief Used to store Error level messages with a module handle.
+ * @param handle The ModuleHandle given by QLoggerManager::module.
+ * @param message The message.
+ */
+#    define QLog_ErrorH(handle, message) QLOGGER_LOG_HANDLE(handle, QLogger::LogLevel::Error, message)
+#endif
+
+#ifndef QLog_FatalH
+/**
+ * @brief Used to store Fatal level messages with a module handle.
+ * @param handle The ModuleHandle given by QLoggerManager::module.
+ * @param message The message.
+ */
+#    define QLog_FatalH(handle, message) QLOGGER_LOG_HANDLE(handle, QLogger::LogLevel::Fatal, message)
 #endif
@@ -1,8 +1,48 @@
 INCLUDEPATH += $$PWD
 
+# The ring buffer uses std::atomic_ref: the library and the targets that build it need C++20.
+CONFIG += c++20
+
+# QLoggerNetworkSink
+QT += network
+
+# Lowest level built in the QLog_* macros: 0 (Trace) to 5 (Fatal), 6 removes all of them.
+# i.e. qmake QLOGGER_MIN_LEVEL=3 to build only Warning, Error and Fatal messages.
+!isEmpty(QLOGGER_MIN_LEVEL): DEFINES += QLOGGER_MIN_LEVEL=$$QLOGGER_MIN_LEVEL
+
 SOURCES += $$PWD/QLogger.cpp \
-    $$PWD/QLoggerWriter.cpp
+    $$PWD/QLoggerBinary.cpp \
+    $$PWD/QLoggerClock.cpp \
+    $$PWD/QLoggerCompressor.cpp \
+    $$PWD/QLoggerConfig.cpp \
+    $$PWD/QLoggerConsole.cpp \
+    $$PWD/QLoggerNetworkSink.cpp \
+    $$PWD/QLoggerPeriodicJob.cpp \
+    $$PWD/QLoggerRetention.cpp \
+    $$PWD/QLoggerRing.cpp \
+    $$PWD/QLoggerStats.cpp \
+    $$PWD/QLoggerThread.cpp \
+    $$PWD/QLoggerUtf8.cpp \
+    $$PWD/QLoggerWriter.cpp \
+    $$PWD/QLoggerWriterPool.cpp
 
 HEADERS += $$PWD/QLogger.h \
+    $$PWD/QLoggerBinary.h \
+    $$PWD/QLoggerClock.h \
+    $$PWD/QLoggerCompressor.h \
+    $$PWD/QLoggerConfig.h \
+    $$PWD/QLoggerConsole.h \
     $$PWD/QLoggerLevel.h \
-    $$PWD/QLoggerWriter.h
+    $$PWD/QLoggerNetworkSink.h \
+    $$PWD/QLoggerPeriodicJob.h \
+    $$PWD/QLoggerQueue.h \
+    $$PWD/QLoggerRecord.h \
+    $$PWD/QLoggerRetention.h \
+    $$PWD/QLoggerRing.h \
+    $$PWD/QLoggerSink.h \
+    $$PWD/QLoggerSnapshot.h \
+    $$PWD/QLoggerStats.h \
+    $$PWD/QLoggerThread.h \
+    $$PWD/QLoggerUtf8.h \
+    $$PWD/QLoggerWriter.h \
+    $$PWD/QLoggerWriterPool.h
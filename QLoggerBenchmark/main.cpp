@@ -0,0 +1,362 @@
+/**
+ * @file main.cpp
+ *
+ * @brief Measures the enqueue throughput, the latency of the QLog_* calls and the end-to-end write throughput of
+ * QLogger, and writes the results in JSON so they can be compared between releases.
+ *
+ * @module QLoggerBenchmark
+ */
+#include <QCoreApplication>
+
+#include "QLogger.h"
+
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace QLogger;
+
+namespace
+{
+/**
+ * @brief One run of the benchmark: the threads log the messages in the modules of one destination.
+ */
+struct Scenario
+{
+    QString name;
+    LogMode mode                = LogMode::OnlyFile;
+    LogMessageDisplays display  = LogMessageDisplay::Default;
+    int modules                 = 1;
+    bool belowThreshold         = false;
+    bool escape                 = false;
+    int threads                 = 1;
+};
+
+QString modeName(LogMode mode)
+{
+    switch (mode)
+    {
+        case LogMode::Disabled:
+            return QStringLiteral("Disabled");
+        case LogMode::OnlyConsole:
+            return QStringLiteral("OnlyConsole");
+        case LogMode::OnlyFile:
+            return QStringLiteral("OnlyFile");
+        case LogMode::Full:
+            return QStringLiteral("Full");
+        case LogMode::MemoryMapped:
+            return QStringLiteral("MemoryMapped");
+    }
+
+    return QString();
+}
+
+qint64 nanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @brief Gets a percentile of sorted values.
+ */
+qint64 percentile(const std::vector<qint64> &sorted, double percent)
+{
+    if (sorted.empty())
+        return 0;
+
+    const auto index = static_cast<size_t>(percent / 100.0 * static_cast<double>(sorted.size() - 1));
+
+    return sorted[index];
+}
+
+/**
+ * @brief Runs a scenario in a destination of its own, so the scenarios don't share queues nor files.
+ * @param scenario The scenario.
+ * @param index The index of the scenario, used in the names of its file and modules.
+ * @param messages The messages logged by each thread.
+ * @param folder The folder of the log files.
+ */
+QJsonObject run(const Scenario &scenario, int index, int messages, const QString &folder)
+{
+    const auto manager = QLoggerManager::getInstance();
+    const auto file    = QString("bench-%1.log").arg(index);
+
+    QStringList modules;
+
+    for (auto i = 0; i < scenario.modules; ++i)
+        modules.append(QString("bench%1-%2").arg(index).arg(i));
+
+    manager->setDefaultEscaping(scenario.escape);
+    manager->addDestination(file, modules, LogLevel::Info, folder, scenario.mode, LogFileDisplay::Number,
+                            scenario.display, false);
+
+    std::vector<std::vector<qint64>> latencies(scenario.threads);
+    std::vector<std::thread> threads;
+    std::atomic<int> ready { 0 };
+    std::atomic<bool> go { false };
+
+    for (auto t = 0; t < scenario.threads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            auto &values = latencies[t];
+            values.resize(messages);
+
+            ready.fetch_add(1);
+
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            for (auto i = 0; i < messages; ++i)
+            {
+                const auto &module = modules.at((i + t) % modules.size());
+                const auto start   = nanoseconds();
+
+                if (scenario.belowThreshold)
+                    QLog_Debug(module, QString("Benchmark message %1 of thread %2").arg(i).arg(t));
+                else
+                    QLog_Info(module, QString("Benchmark message %1 of thread %2").arg(i).arg(t));
+
+                values[i] = nanoseconds() - start;
+            }
+        });
+    }
+
+    while (ready.load() < scenario.threads)
+        std::this_thread::yield();
+
+    const auto start = nanoseconds();
+    go.store(true, std::memory_order_release);
+
+    for (auto &thread : threads)
+        thread.join();
+
+    const auto enqueued = nanoseconds();
+
+    manager->flushAll();
+
+    const auto written = nanoseconds();
+
+    std::vector<qint64> all;
+    all.reserve(static_cast<size_t>(messages) * scenario.threads);
+
+    for (const auto &values : latencies)
+        all.insert(all.end(), values.cbegin(), values.cend());
+
+    std::sort(all.begin(), all.end());
+
+    const auto total           = static_cast<double>(messages) * scenario.threads;
+    const auto enqueueSeconds  = (enqueued - start) / 1e9;
+    const auto endToEndSeconds = (written - start) / 1e9;
+
+    QJsonObject latency;
+    latency["p50"]  = percentile(all, 50);
+    latency["p99"]  = percentile(all, 99);
+    latency["p999"] = percentile(all, 99.9);
+    latency["max"]  = all.empty() ? 0 : all.back();
+
+    QJsonObject result;
+    result["name"]                   = scenario.name;
+    result["mode"]                   = modeName(scenario.mode);
+    result["display"]                = static_cast<qint64>(static_cast<unsigned int>(scenario.display));
+    result["modules"]                = scenario.modules;
+    result["level"]                  = scenario.belowThreshold ? QStringLiteral("below") : QStringLiteral("above");
+    result["escape"]                 = scenario.escape;
+    result["threads"]                = scenario.threads;
+    result["messages"]               = static_cast<qint64>(total);
+    result["enqueue_seconds"]        = enqueueSeconds;
+    result["enqueue_messages_per_s"] = enqueueSeconds > 0 ? total / enqueueSeconds : 0.0;
+    result["latency_ns"]             = latency;
+    result["end_to_end_seconds"]     = endToEndSeconds;
+    result["written_messages_per_s"] = endToEndSeconds > 0 ? total / endToEndSeconds : 0.0;
+
+    // The counters of the destination tell if messages were dropped or filtered
+    for (const auto &writer : manager->stats().writers)
+    {
+        if (QFileInfo(writer.fileDestination).fileName() == file)
+        {
+            result["written"]       = static_cast<qint64>(writer.written);
+            result["dropped"]       = static_cast<qint64>(writer.dropped);
+            result["bytes_written"] = static_cast<qint64>(writer.bytesWritten);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Builds the scenarios: a base one and, from it, one axis changed at a time, each with every thread count.
+ */
+QVector<Scenario> scenarios(const QVector<int> &threadCounts)
+{
+    QVector<Scenario> axes;
+
+    Scenario base;
+    base.name = QStringLiteral("base");
+    axes.append(base);
+
+    const QVector<QPair<QString, LogMode>> modes { { "mode-disabled", LogMode::Disabled },
+                                                    { "mode-console", LogMode::OnlyConsole },
+                                                    { "mode-full", LogMode::Full },
+                                                    { "mode-mapped", LogMode::MemoryMapped } };
+
+    for (const auto &mode : modes)
+    {
+        auto scenario = base;
+        scenario.name = mode.first;
+        scenario.mode = mode.second;
+        axes.append(scenario);
+    }
+
+    const QVector<QPair<QString, LogMessageDisplays>> displays {
+        { "display-message", LogMessageDisplay::Message },
+        { "display-default2", LogMessageDisplay::Default2 },
+        { "display-full", LogMessageDisplay::Full },
+        { "display-json", LogMessageDisplays(LogMessageDisplay::Default) | LogMessageDisplay::Json }
+    };
+
+    for (const auto &display : displays)
+    {
+        auto scenario    = base;
+        scenario.name    = display.first;
+        scenario.display = display.second;
+        axes.append(scenario);
+    }
+
+    auto escaped   = base;
+    escaped.name   = QStringLiteral("display-escaped");
+    escaped.escape = true;
+    axes.append(escaped);
+
+    auto manyModules    = base;
+    manyModules.name    = QStringLiteral("modules-32");
+    manyModules.modules = 32;
+    axes.append(manyModules);
+
+    auto below           = base;
+    below.name           = QStringLiteral("below-threshold");
+    below.belowThreshold = true;
+    axes.append(below);
+
+    QVector<Scenario> all;
+
+    for (const auto &scenario : axes)
+    {
+        for (const auto threads : threadCounts)
+        {
+            auto run    = scenario;
+            run.threads = threads;
+            all.append(run);
+        }
+    }
+
+    return all;
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the throughput and the latency of QLogger.");
+    parser.addHelpOption();
+
+    const QCommandLineOption messagesOption(QStringList { "m", "messages" }, "Messages logged by each thread.",
+                                            "count", "100000");
+    const QCommandLineOption threadsOption(QStringList { "t", "threads" },
+                                           "Numbers of threads logging at the same time, separated by commas.",
+                                           "counts", "1,4");
+    const QCommandLineOption filterOption(QStringList { "f", "filter" },
+                                          "Runs only the scenarios whose name contains <text>.", "text");
+    const QCommandLineOption outputOption(QStringList { "o", "output" },
+                                          "Writes the results in <file> instead of QLoggerBenchmark.json.", "file",
+                                          "QLoggerBenchmark.json");
+
+    parser.addOption(messagesOption);
+    parser.addOption(threadsOption);
+    parser.addOption(filterOption);
+    parser.addOption(outputOption);
+    parser.process(a);
+
+    auto ok             = false;
+    const auto messages = parser.value(messagesOption).toInt(&ok);
+
+    QVector<int> threadCounts;
+
+    for (const auto &count : parser.value(threadsOption).split(','))
+    {
+        auto valid        = false;
+        const auto number = count.trimmed().toInt(&valid);
+
+        if (!valid || number <= 0)
+            parser.showHelp(1);
+
+        threadCounts.append(number);
+    }
+
+    if (!ok || messages <= 0)
+        parser.showHelp(1);
+
+    const auto folder
+        = QDir(QDir::tempPath()).filePath(QString("QLoggerBenchmark-%1").arg(QCoreApplication::applicationPid()));
+
+    // Rotated files are not compressed, so an external 7z doesn't run during the measures
+    const auto manager = QLoggerManager::getInstance();
+    manager->setDefaultCompression(LogCompression::None);
+
+    QJsonArray results;
+    auto index = 0;
+
+    for (const auto &scenario : scenarios(threadCounts))
+    {
+        if (parser.isSet(filterOption) && !scenario.name.contains(parser.value(filterOption)))
+            continue;
+
+        const auto result = run(scenario, index++, messages, folder);
+
+        results.append(result);
+        qInfo().noquote() << scenario.name << scenario.threads << "threads:"
+                          << result["enqueue_messages_per_s"].toDouble() << "messages/s";
+    }
+
+    QJsonObject system;
+    system["qt"]        = QString::fromLatin1(qVersion());
+    system["os"]        = QSysInfo::prettyProductName();
+    system["cpu"]       = QSysInfo::currentCpuArchitecture();
+    system["cores"]     = QThread::idealThreadCount();
+    system["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+    QJsonObject document;
+    document["system"]              = system;
+    document["messages_per_thread"] = messages;
+    document["results"]             = results;
+
+    QFile output(parser.value(outputOption));
+
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCritical().noquote() << output.errorString();
+        return 1;
+    }
+
+    output.write(QJsonDocument(document).toJson());
+    output.close();
+
+    QDir(folder).removeRecursively();
+
+    return 0;
+}
@@ -0,0 +1,468 @@
+#include "QLoggerBinary.h"
+
+#include <QFile>
+#include <QLoggerUtf8.h>
+#include <QMutex>
+#include <QSet>
+#include <QVarLengthArray>
+
+#include <cstring>
+
+namespace
+{
+const char SEGMENT_MAGIC[8] = { '\0', 'Q', 'L', 'B', 'I', 'N', '0', '1' };
+
+enum Tag : char
+{
+    SegmentTag = '\0',
+    StringTag  = '\1',
+    RecordTag  = '\2',
+    LineTag    = '\3'
+};
+
+/**
+ * @brief Types of the values of the fields.
+ */
+enum ValueType : char
+{
+    TextValue     = '\0',
+    SignedValue   = '\1',
+    UnsignedValue = '\2',
+    DoubleValue   = '\3',
+    BoolValue     = '\4'
+};
+
+void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    out.append(static_cast<char>(value));
+}
+
+void appendSigned(QByteArray &out, qint64 value)
+{
+    appendVarint(out, (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63));
+}
+
+void appendFixed64(QByteArray &out, quint64 value)
+{
+    for (int i = 0; i < 8; ++i)
+        out.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+/**
+ * @brief Gets a copy of the key that lives until the end of the program, as LogField requires.
+ */
+const char *internKey(const QString &key)
+{
+    static QMutex mutex;
+    static QSet<QByteArray> keys;
+
+    QMutexLocker locker(&mutex);
+
+    const auto utf8 = key.toUtf8();
+    auto iter       = keys.constFind(utf8);
+
+    if (iter == keys.constEnd())
+        iter = keys.insert(utf8);
+
+    return iter->constData();
+}
+
+/**
+ * @brief The Reader class reads the values of a binary log file. It stops at the end of the data.
+ */
+class Reader
+{
+public:
+    explicit Reader(const QByteArray &data)
+        : mData(data)
+    {
+    }
+
+    bool atEnd() const { return mPos >= mData.size(); }
+    bool isValid() const { return mValid; }
+    qsizetype position() const { return mPos; }
+
+    char tag() { return available(1) ? mData.at(mPos++) : '\0'; }
+
+    quint64 varint()
+    {
+        quint64 value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (!available(1))
+                return 0;
+
+            const auto byte = static_cast<quint8>(mData.at(mPos++));
+            value |= static_cast<quint64>(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+                return value;
+        }
+
+        mValid = false;
+        return 0;
+    }
+
+    qint64 signedVarint()
+    {
+        const auto value = varint();
+
+        return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+    }
+
+    qint64 fixed64()
+    {
+        qint64 value = 0;
+
+        if (available(8))
+        {
+            for (int i = 0; i < 8; ++i)
+                value |= static_cast<qint64>(static_cast<quint8>(mData.at(mPos + i))) << (8 * i);
+
+            mPos += 8;
+        }
+
+        return value;
+    }
+
+    QString text()
+    {
+        const auto size = varint();
+
+        if (!available(size))
+            return QString();
+
+        const auto text = QString::fromUtf8(mData.constData() + mPos, static_cast<qsizetype>(size));
+        mPos += static_cast<qsizetype>(size);
+
+        return text;
+    }
+
+    QVariant value()
+    {
+        switch (tag())
+        {
+            case SignedValue:
+                return signedVarint();
+            case UnsignedValue:
+                return varint();
+            case DoubleValue:
+            {
+                const auto bits = fixed64();
+                double number;
+                std::memcpy(&number, &bits, sizeof(number));
+
+                return number;
+            }
+            case BoolValue:
+                return tag() != '\0';
+            case TextValue:
+                return text();
+            default:
+                mValid = false;
+                return QVariant();
+        }
+    }
+
+    bool skipMagic()
+    {
+        if (!available(sizeof(SEGMENT_MAGIC) - 1)
+            || std::memcmp(mData.constData() + mPos, SEGMENT_MAGIC + 1, sizeof(SEGMENT_MAGIC) - 1) != 0)
+        {
+            mValid = false;
+            return false;
+        }
+
+        mPos += sizeof(SEGMENT_MAGIC) - 1;
+        return true;
+    }
+
+private:
+    const QByteArray &mData;
+    qsizetype mPos = 0;
+    bool mValid    = true;
+
+    bool available(quint64 size)
+    {
+        if (mValid && static_cast<quint64>(mData.size() - mPos) >= size)
+            return true;
+
+        mValid = false;
+        return false;
+    }
+};
+}  // namespace
+
+namespace QLogger
+{
+
+void QLoggerBinary::reset()
+{
+    mSegmentStarted = false;
+    mNextString     = 0;
+    mStrings.clear();
+    mThreadNames.clear();
+}
+
+void QLoggerBinary::startSegment(QByteArray &out, qint64 msecsSinceEpoch)
+{
+    out.append(SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+
+    appendFixed64(out, static_cast<quint64>(msecsSinceEpoch));
+
+    mSegmentStarted = true;
+    mLastTime       = msecsSinceEpoch;
+}
+
+quint32 QLoggerBinary::defineString(QByteArray &out, const QString &text)
+{
+    const auto id = mNextString++;
+
+    out.append(StringTag);
+    appendVarint(out, id);
+    appendText(out, text);
+
+    return id;
+}
+
+quint32 QLoggerBinary::stringId(QByteArray &out, const void *key, const QString &text)
+{
+    const auto iter = mStrings.constFind(key);
+
+    if (iter != mStrings.constEnd())
+        return iter.value();
+
+    const auto id = defineString(out, text);
+    mStrings.insert(key, id);
+
+    return id;
+}
+
+void QLoggerBinary::appendTime(QByteArray &out, qint64 msecsSinceEpoch)
+{
+    appendSigned(out, msecsSinceEpoch - mLastTime);
+    mLastTime = msecsSinceEpoch;
+}
+
+void QLoggerBinary::appendText(QByteArray &out, const QString &text)
+{
+    mText.truncate(0);
+    QLoggerUtf8::append(mText, text);
+
+    appendVarint(out, static_cast<quint64>(mText.size()));
+    out.append(mText);
+}
+
+void QLoggerBinary::append(QByteArray &out, const LogRecord &record, qint64 msecsSinceEpoch, const QString &threadName)
+{
+    if (!mSegmentStarted)
+        startSegment(out, msecsSinceEpoch);
+
+    // The strings are defined before the record that uses them
+    const auto module   = stringId(out, record.module, *record.module);
+    const auto function = stringId(out, record.site->function, QString::fromUtf8(record.site->function));
+    const auto file     = stringId(out, record.site->file, QString::fromUtf8(record.site->file));
+
+    // The names of the threads can change, so they are looked up by value
+    const auto iter = mThreadNames.constFind(threadName);
+    auto thread     = iter != mThreadNames.constEnd() ? iter.value() : 0u;
+
+    if (iter == mThreadNames.constEnd())
+    {
+        thread = defineString(out, threadName);
+        mThreadNames.insert(threadName, thread);
+    }
+
+    out.append(RecordTag);
+    appendTime(out, msecsSinceEpoch);
+    out.append(static_cast<char>(record.level));
+    appendVarint(out, module);
+    appendVarint(out, thread);
+    appendVarint(out, function);
+    appendVarint(out, file);
+    appendSigned(out, record.site->line);
+    appendText(out, record.message);
+    appendFields(out, record.fields);
+}
+
+void QLoggerBinary::appendFields(QByteArray &out, const LogFields &fields)
+{
+    // The keys are defined in the middle of the record, so their ids are taken first
+    QVarLengthArray<quint32, 8> keys;
+
+    for (const auto &field : fields)
+        keys.append(stringId(out, field.key, QString::fromUtf8(field.key)));
+
+    appendVarint(out, static_cast<quint64>(fields.size()));
+
+    for (qsizetype i = 0; i < fields.size(); ++i)
+    {
+        const auto &value = fields.at(i).value;
+
+        appendVarint(out, keys.at(i));
+
+        switch (value.metaType().id())
+        {
+            case QMetaType::Bool:
+                out.append(BoolValue);
+                out.append(value.toBool() ? '\1' : '\0');
+                break;
+            case QMetaType::Int:
+            case QMetaType::Long:
+            case QMetaType::LongLong:
+            case QMetaType::Short:
+                out.append(SignedValue);
+                appendSigned(out, value.toLongLong());
+                break;
+            case QMetaType::UInt:
+            case QMetaType::ULong:
+            case QMetaType::ULongLong:
+            case QMetaType::UShort:
+                out.append(UnsignedValue);
+                appendVarint(out, value.toULongLong());
+                break;
+            case QMetaType::Double:
+            case QMetaType::Float:
+            {
+                const auto number = value.toDouble();
+                quint64 bits;
+                std::memcpy(&bits, &number, sizeof(bits));
+
+                out.append(DoubleValue);
+                appendFixed64(out, bits);
+                break;
+            }
+            default:
+                out.append(TextValue);
+                appendText(out, value.toString());
+        }
+    }
+}
+
+void QLoggerBinary::appendLine(QByteArray &out, qint64 msecsSinceEpoch, const QString &line)
+{
+    if (!mSegmentStarted)
+        startSegment(out, msecsSinceEpoch);
+
+    out.append(LineTag);
+    appendTime(out, msecsSinceEpoch);
+    appendText(out, line);
+}
+
+bool QLoggerBinary::isBinary(const QByteArray &data)
+{
+    return data.size() >= static_cast<qsizetype>(sizeof(SEGMENT_MAGIC))
+        && std::memcmp(data.constData(), SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) == 0;
+}
+
+QVector<LogEntry> QLoggerBinary::read(const QString &path, QString *error)
+{
+    QVector<LogEntry> entries;
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (error)
+            *error = file.errorString();
+
+        return entries;
+    }
+
+    const auto content = file.readAll();
+
+    if (!isBinary(content))
+    {
+        if (error)
+            *error = QStringLiteral("%1 is not a binary log file").arg(path);
+
+        return entries;
+    }
+
+    Reader reader(content);
+    QVector<QString> strings;
+    qint64 time = 0;
+
+    while (!reader.atEnd() && reader.isValid())
+    {
+        switch (reader.tag())
+        {
+            case SegmentTag:
+                if (!reader.skipMagic())
+                    break;
+
+                strings.clear();
+                time = reader.fixed64();
+                break;
+            case StringTag:
+            {
+                const auto id   = reader.varint();
+                const auto text = reader.text();
+
+                if (id != static_cast<quint64>(strings.size()))
+                    break;
+
+                strings.append(text);
+                break;
+            }
+            case RecordTag:
+            {
+                LogEntry entry;
+
+                time += reader.signedVarint();
+                entry.msecsSinceEpoch = time;
+                entry.level           = static_cast<LogLevel>(reader.tag());
+                entry.module          = strings.value(static_cast<qsizetype>(reader.varint()));
+                entry.threadId        = strings.value(static_cast<qsizetype>(reader.varint()));
+                entry.function        = strings.value(static_cast<qsizetype>(reader.varint()));
+                entry.file            = strings.value(static_cast<qsizetype>(reader.varint()));
+                entry.line            = static_cast<int>(reader.signedVarint());
+                entry.message         = reader.text();
+
+                const auto fields = reader.varint();
+
+                for (quint64 i = 0; i < fields && reader.isValid(); ++i)
+                {
+                    const auto key = strings.value(static_cast<qsizetype>(reader.varint()));
+
+                    entry.fields.append({ internKey(key), reader.value() });
+                }
+
+                if (reader.isValid())
+                    entries.append(entry);
+
+                break;
+            }
+            case LineTag:
+            {
+                LogEntry entry;
+
+                time += reader.signedVarint();
+                entry.msecsSinceEpoch = time;
+                entry.formatted       = true;
+                entry.message         = reader.text();
+
+                if (reader.isValid())
+                    entries.append(entry);
+
+                break;
+            }
+            default:
+                if (error)
+                    *error = QStringLiteral("%1: unknown record at offset %2").arg(path).arg(reader.position() - 1);
+
+                return entries;
+        }
+    }
+
+    return entries;
+}
+
+}  // namespace QLogger
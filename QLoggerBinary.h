@@ -0,0 +1,93 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QHash>
+#include <QLoggerRecord.h>
+#include <QString>
+#include <QVector>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerBinary class encodes the records in the compact format of LogFormat::Binary and decodes them.
+ *
+ * A file is a sequence of segments. Each time the writer opens the file it starts a new segment: a tag, a magic
+ * number and the time of the segment. The module, function, file and thread names are written once per segment in a
+ * string definition and then referenced by their index. Times are written as the difference with the previous
+ * record. Numbers use variable-length encoding and the messages are stored in UTF-8. The fields of structured messages
+ * keep the type of their values.
+ */
+class QLoggerBinary
+{
+public:
+    /**
+    * @brief reset Forgets the strings written, so the next record starts a new segment.
+    */
+    void reset();
+
+    /**
+    * @brief append Encodes a record at the end of the buffer.
+    * @param out The buffer.
+    * @param record The record. Its module must not be null.
+    * @param msecsSinceEpoch The time of the record.
+    * @param threadName The name displayed for the thread of the record.
+    */
+    void append(QByteArray &out, const LogRecord &record, qint64 msecsSinceEpoch, const QString &threadName);
+
+    /**
+    * @brief appendLine Encodes an already formatted line at the end of the buffer.
+    */
+    void appendLine(QByteArray &out, qint64 msecsSinceEpoch, const QString &line);
+
+    /**
+    * @brief isBinary Whether the data is the beginning of a binary log file.
+    */
+    static bool isBinary(const QByteArray &data);
+
+    /**
+    * @brief read Reads the records of a binary log file. A record cut at the end of the file is ignored.
+    * @param path The path of the file.
+    * @param error If not null, receives the reason why the file can't be read.
+    */
+    static QVector<LogEntry> read(const QString &path, QString *error = nullptr);
+
+private:
+    bool mSegmentStarted = false;
+    qint64 mLastTime     = 0;
+    quint32 mNextString  = 0;
+    QHash<const void *, quint32> mStrings;
+    QHash<QString, quint32> mThreadNames;
+    QByteArray mText;
+
+    void startSegment(QByteArray &out, qint64 msecsSinceEpoch);
+    quint32 defineString(QByteArray &out, const QString &text);
+    quint32 stringId(QByteArray &out, const void *key, const QString &text);
+    void appendTime(QByteArray &out, qint64 msecsSinceEpoch);
+    void appendText(QByteArray &out, const QString &text);
+    void appendFields(QByteArray &out, const LogFields &fields);
+};
+
+}  // namespace QLogger
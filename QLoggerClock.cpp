@@ -0,0 +1,60 @@
+#include "QLoggerClock.h"
+
+#include <QDateTime>
+
+namespace QLogger
+{
+
+std::atomic<qint64> &QLoggerClock::offset()
+{
+    static std::atomic<qint64> offset { QDateTime::currentMSecsSinceEpoch() * 1000000 - now() };
+
+    return offset;
+}
+
+void QLoggerClock::calibrate()
+{
+    offset().store(QDateTime::currentMSecsSinceEpoch() * 1000000 - now(), std::memory_order_relaxed);
+}
+
+QString QLoggerTimestamp::format(qint64 msecsSinceEpoch)
+{
+    QString text;
+    append(text, msecsSinceEpoch);
+
+    return text;
+}
+
+void QLoggerTimestamp::append(QString &text, qint64 msecsSinceEpoch)
+{
+    const auto msecs = static_cast<int>(msecsSinceEpoch % 1000);
+
+    update(msecsSinceEpoch / 1000);
+
+    text.append(mPrefix);
+    text.append(QLatin1Char(':'));
+    text.append(QLatin1Char('0' + msecs / 100));
+    text.append(QLatin1Char('0' + msecs / 10 % 10));
+    text.append(QLatin1Char('0' + msecs % 10));
+}
+
+QDate QLoggerTimestamp::date(qint64 msecsSinceEpoch)
+{
+    update(msecsSinceEpoch / 1000);
+
+    return mDate;
+}
+
+void QLoggerTimestamp::update(qint64 second)
+{
+    if (second != mSecond)
+    {
+        const auto dateTime = QDateTime::fromSecsSinceEpoch(second);
+
+        mSecond = second;
+        mPrefix = dateTime.toString("yyyy-MM-dd hh:mm:ss");
+        mDate   = dateTime.date();
+    }
+}
+
+}  // namespace QLogger
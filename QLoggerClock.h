@@ -0,0 +1,106 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QDate>
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerClock class is the time source of the log records. The producers only read a monotonic tick,
+ * which is much cheaper than QDateTime::currentDateTime() since it doesn't involve any time zone conversion. The
+ * writer threads convert the ticks to wall-clock time with an offset that they recalibrate periodically.
+ */
+class QLoggerClock
+{
+public:
+    /**
+    * @brief now Gets the current tick in nanoseconds of the monotonic clock.
+    */
+    static qint64 now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+    * @brief toMSecsSinceEpoch Converts a tick to milliseconds since the epoch.
+    * @param tick The tick given by now().
+    */
+    static qint64 toMSecsSinceEpoch(qint64 tick) { return (tick + offset().load(std::memory_order_relaxed)) / 1000000; }
+
+    /**
+    * @brief currentMSecsSinceEpoch Gets the current wall-clock time in milliseconds since the epoch.
+    */
+    static qint64 currentMSecsSinceEpoch() { return toMSecsSinceEpoch(now()); }
+
+    /**
+    * @brief calibrate Recomputes the offset between the monotonic clock and the wall clock, so changes of the system
+    * time are picked up. It is cheap and it can be called from any thread.
+    */
+    static void calibrate();
+
+private:
+    static std::atomic<qint64> &offset();
+};
+
+/**
+ * @brief The QLoggerTimestamp class formats timestamps as "yyyy-MM-dd hh:mm:ss:zzz". The date and time part is
+ * converted to local time only once per second; the milliseconds are appended for every line. It is not thread-safe,
+ * every writer has its own instance.
+ */
+class QLoggerTimestamp
+{
+public:
+    /**
+    * @brief format Formats the given time.
+    * @param msecsSinceEpoch The time in milliseconds since the epoch.
+    */
+    QString format(qint64 msecsSinceEpoch);
+
+    /**
+    * @brief append Formats the given time at the end of a text, without a temporary string.
+    * @param text The text.
+    * @param msecsSinceEpoch The time in milliseconds since the epoch.
+    */
+    void append(QString &text, qint64 msecsSinceEpoch);
+
+    /**
+    * @brief date Gets the local date of the given time.
+    * @param msecsSinceEpoch The time in milliseconds since the epoch.
+    */
+    QDate date(qint64 msecsSinceEpoch);
+
+private:
+    qint64 mSecond = -1;
+    QString mPrefix;
+    QDate mDate;
+
+    void update(qint64 second);
+};
+
+}  // namespace QLogger
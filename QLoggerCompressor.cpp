@@ -0,0 +1,244 @@
+#include "QLoggerCompressor.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+
+#include <array>
+
+namespace
+{
+/**
+ * @brief Size of the chunks compressed as independent gzip members. Concatenated members are a valid gzip file.
+ */
+const qint64 GZIP_CHUNK_SIZE = 4 * 1024 * 1024;
+
+quint32 crc32(const QByteArray &data)
+{
+    static const auto table = []() {
+        std::array<quint32, 256> values {};
+
+        for (quint32 i = 0; i < 256; ++i)
+        {
+            auto value = i;
+
+            for (int bit = 0; bit < 8; ++bit)
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+
+            values[i] = value;
+        }
+
+        return values;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+
+    for (const auto byte : data)
+        crc = table[(crc ^ static_cast<quint8>(byte)) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendLittleEndian(QByteArray &out, quint32 value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+/**
+ * @brief Builds a gzip member for the chunk. qCompress gives a zlib stream preceded by the uncompressed size: without
+ * those 4 bytes, the 2 bytes of zlib header and the 4 bytes of Adler-32 checksum it is a raw deflate stream.
+ */
+QByteArray gzipMember(const QByteArray &chunk, int level)
+{
+    static const char header[] = { '\x1f', '\x8b', '\x08', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\xff' };
+
+    QByteArray member(header, sizeof(header));
+
+    const auto zlib = qCompress(chunk, level);
+
+    if (zlib.size() > 10)
+        member.append(zlib.constData() + 6, zlib.size() - 10);
+    else
+        member.append("\x03\x00", 2);  // Empty deflate block
+
+    appendLittleEndian(member, crc32(chunk));
+    appendLittleEndian(member, static_cast<quint32>(chunk.size()));
+
+    return member;
+}
+}  // namespace
+
+namespace QLogger
+{
+
+QLoggerCompressor *QLoggerCompressor::getInstance()
+{
+    static QLoggerCompressor INSTANCE;
+
+    return &INSTANCE;
+}
+
+QLoggerCompressor::QLoggerCompressor()
+{
+    mPool.setMaxThreadCount(1);
+}
+
+QLoggerCompressor::~QLoggerCompressor()
+{
+    // Files not started yet stay uncompressed
+    mPool.clear();
+    mPool.waitForDone();
+}
+
+bool QLoggerCompressor::compress(const QString &path, LogCompression compression, int level, std::function<void()> done)
+{
+    if (compression == LogCompression::None)
+        return false;
+
+    if (mPendingFiles.fetch_add(1, std::memory_order_relaxed) >= mMaxPendingFiles)
+    {
+        mPendingFiles.fetch_sub(1, std::memory_order_relaxed);
+        mSkippedFiles.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    mPool.start([this, path, compression, level, done = std::move(done)]() {
+        QElapsedTimer time;
+        time.start();
+
+        QString result;
+        const auto compressed = compression == LogCompression::SevenZip ? sevenZip(path, level, &result)
+                                                                        : gzip(path, level, &result);
+
+        mCompressionTime.record(time.elapsed());
+        (compressed ? mCompressedFiles : mFailedFiles).fetch_add(1, std::memory_order_relaxed);
+
+        {
+            QMutexLocker locker(&mResultMutex);
+            mLastResult = result;
+        }
+
+        mPendingFiles.fetch_sub(1, std::memory_order_relaxed);
+
+        if (done)
+            done();
+    });
+
+    return true;
+}
+
+QString QLoggerCompressor::archiveName(const QString &path, LogCompression compression)
+{
+    switch (compression)
+    {
+        case LogCompression::SevenZip:
+            // cut .log, add .7z
+            return path.mid(0, path.size() - 4) + ".7z";
+        case LogCompression::Gzip:
+            return path + ".gz";
+        case LogCompression::None:
+            break;
+    }
+
+    return path;
+}
+
+LogCompressionStats QLoggerCompressor::stats() const
+{
+    LogCompressionStats stats;
+    stats.compressed = mCompressedFiles.load(std::memory_order_relaxed);
+    stats.failed     = mFailedFiles.load(std::memory_order_relaxed);
+    stats.skipped    = mSkippedFiles.load(std::memory_order_relaxed);
+    stats.pending    = mPendingFiles.load(std::memory_order_relaxed);
+    stats.time       = mCompressionTime.values();
+
+    QMutexLocker locker(&mResultMutex);
+    stats.lastResult = mLastResult;
+
+    return stats;
+}
+
+bool QLoggerCompressor::sevenZip(const QString &path, int level, QString *result)
+{
+    QElapsedTimer time;
+    time.start();
+
+    const auto archiveName = QLoggerCompressor::archiveName(path, LogCompression::SevenZip);
+
+    QStringList param;
+    param << "a"
+          << "-t7z"
+          << QString("-mx%1").arg(level)
+          << archiveName << path;
+
+    QProcess zip;
+
+    QString pathExe = "7z";
+    zip.start(pathExe, param);
+
+    bool res = zip.waitForFinished(1000 * 60 * 15);  // 15 min
+
+    auto exitStatus        = (bool)zip.exitStatus();
+    const auto zipExitCode = zip.exitCode();
+
+    zip.close();
+
+    if (result)
+    {
+        *result = QString("%1 to archive : %2. %3. Time::%4")
+                      .arg(path,
+                           archiveName,
+                           QString("finished: %1, %2").arg(res ? "yes" : "no", exitStatus ? "The process crashed" : "The process exited normall"),
+                           QString::number(time.elapsed()));
+    }
+
+    return res && !exitStatus && zipExitCode == 0;
+}
+
+bool QLoggerCompressor::gzip(const QString &path, int level, QString *result)
+{
+    QElapsedTimer time;
+    time.start();
+
+    const auto archiveName = QLoggerCompressor::archiveName(path, LogCompression::Gzip);
+
+    QFile input(path);
+    QFile output(archiveName);
+
+    if (!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        if (result)
+            *result = QString("%1 to archive : %2. Can't open the files").arg(path, archiveName);
+
+        return false;
+    }
+
+    auto succeeded = true;
+
+    do
+    {
+        const auto chunk = input.read(GZIP_CHUNK_SIZE);
+        const auto member = gzipMember(chunk, level);
+
+        succeeded = output.write(member) == member.size();
+    } while (succeeded && !input.atEnd());
+
+    input.close();
+    output.close();
+
+    if (succeeded)
+        QFile::remove(path);
+    else
+        QFile::remove(archiveName);
+
+    if (result)
+    {
+        *result = QString("%1 to archive : %2. finished: %3. Time::%4")
+                      .arg(path, archiveName, succeeded ? "yes" : "no", QString::number(time.elapsed()));
+    }
+
+    return succeeded;
+}
+
+}  // namespace QLogger
@@ -0,0 +1,117 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerLevel.h>
+#include <QLoggerStats.h>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerCompressor class compresses the rotated log files in the background, so the writers continue in
+ * the new file right away. The jobs run in a small thread pool of its own and the number of pending jobs is bounded:
+ * if too many files are waiting, new ones are left uncompressed.
+ */
+class QLoggerCompressor
+{
+public:
+    /**
+    * @brief Gets the instance shared by all the writers.
+    */
+    static QLoggerCompressor *getInstance();
+
+    /**
+    * @brief compress Enqueues the compression of a file.
+    * @param path The file to compress.
+    * @param compression The compression method. LogCompression::SevenZip keeps the original file,
+    * LogCompression::Gzip replaces it with a .gz file.
+    * @param level The compression level, from 1 (fastest) to 9 (smallest).
+    * @param done If set, called from the thread of the compression when it is done, whether it succeeded or not.
+    * @return False if the file is not going to be compressed. done is not called then.
+    */
+    bool compress(const QString &path, LogCompression compression, int level, std::function<void()> done = {});
+
+    /**
+    * @brief archiveName Gets the name of the file created by the compression of a file.
+    */
+    static QString archiveName(const QString &path, LogCompression compression);
+
+    /**
+    * @brief setMaxThreadCount Sets the number of files compressed at the same time.
+    */
+    void setMaxThreadCount(int threads) { mPool.setMaxThreadCount(qMax(threads, 1)); }
+
+    /**
+    * @brief setMaxPendingFiles Sets the number of files that can wait to be compressed.
+    */
+    void setMaxPendingFiles(int files) { mMaxPendingFiles = files; }
+
+    /**
+    * @brief waitForDone Waits until all the pending files are compressed.
+    * @param msecs Maximum time to wait, -1 to wait forever.
+    * @return True if all the files were compressed in time.
+    */
+    bool waitForDone(int msecs = -1) { return mPool.waitForDone(msecs); }
+
+    /**
+    * @brief stats Gets the counters of the compressions.
+    */
+    LogCompressionStats stats() const;
+
+    /**
+    * @brief sevenZip Compresses the file in a .7z archive with the external 7z program.
+    * @param result If not null, receives a description of the result.
+    * @return True if the archive was created.
+    */
+    static bool sevenZip(const QString &path, int level, QString *result = nullptr);
+
+    /**
+    * @brief gzip Compresses the file in a .gz file in-process and removes the original file if it succeeds.
+    * @param result If not null, receives a description of the result.
+    * @return True if the file was compressed.
+    */
+    static bool gzip(const QString &path, int level, QString *result = nullptr);
+
+private:
+    QThreadPool mPool;
+    std::atomic<int> mPendingFiles { 0 };
+    int mMaxPendingFiles = 16;
+    std::atomic<quint64> mCompressedFiles { 0 };
+    std::atomic<quint64> mFailedFiles { 0 };
+    std::atomic<quint64> mSkippedFiles { 0 };
+    QLoggerHistogram mCompressionTime;
+    mutable QMutex mResultMutex;
+    QString mLastResult;
+
+    QLoggerCompressor();
+    ~QLoggerCompressor();
+};
+
+}  // namespace QLogger
@@ -0,0 +1,138 @@
+#include "QLoggerConfig.h"
+
+#include <QDeadlineTimer>
+#include <QFileInfo>
+#include <QSettings>
+
+namespace
+{
+/**
+ * @brief Converts the name of a level, without case.
+ */
+std::optional<QLogger::LogLevel> textToLevel(const QString &text)
+{
+    using QLogger::LogLevel;
+
+    static const QHash<QString, LogLevel> levels { { "trace", LogLevel::Trace },     { "debug", LogLevel::Debug },
+                                                   { "info", LogLevel::Info },       { "warning", LogLevel::Warning },
+                                                   { "error", LogLevel::Error },     { "fatal", LogLevel::Fatal } };
+
+    const auto iter = levels.constFind(text.trimmed().toLower());
+
+    return iter == levels.constEnd() ? std::nullopt : std::optional<LogLevel>(iter.value());
+}
+
+/**
+ * @brief Converts the name of a mode, without case.
+ */
+std::optional<QLogger::LogMode> textToMode(const QString &text)
+{
+    using QLogger::LogMode;
+
+    static const QHash<QString, LogMode> modes { { "disabled", LogMode::Disabled },
+                                                 { "onlyconsole", LogMode::OnlyConsole },
+                                                 { "onlyfile", LogMode::OnlyFile },
+                                                 { "full", LogMode::Full },
+                                                 { "memorymapped", LogMode::MemoryMapped } };
+
+    const auto iter = modes.constFind(text.trimmed().toLower());
+
+    return iter == modes.constEnd() ? std::nullopt : std::optional<LogMode>(iter.value());
+}
+}  // namespace
+
+namespace QLogger
+{
+
+bool LogConfig::read(const QString &path, LogConfig &config)
+{
+    QSettings settings(path, QSettings::IniFormat);
+
+    if (settings.status() != QSettings::NoError)
+        return false;
+
+    config = LogConfig();
+
+    if (settings.contains("level"))
+        config.level = textToLevel(settings.value("level").toString());
+
+    if (settings.contains("mode"))
+        config.mode = textToMode(settings.value("mode").toString());
+
+    if (settings.contains("paused"))
+        config.paused = settings.value("paused").toBool();
+
+    settings.beginGroup("modules");
+
+    for (const auto &module : settings.childKeys())
+    {
+        if (const auto level = textToLevel(settings.value(module).toString()))
+            config.modules.insert(module, *level);
+    }
+
+    settings.endGroup();
+
+    return true;
+}
+
+QLoggerConfigWatcher::QLoggerConfigWatcher(const QString &path, int interval,
+                                           std::function<void(const LogConfig &)> apply)
+    : mPath(path)
+    , mInterval(qMax(interval, 1))
+    , mApply(std::move(apply))
+{
+    start(QThread::LowPriority);
+}
+
+QLoggerConfigWatcher::~QLoggerConfigWatcher()
+{
+    {
+        QMutexLocker locker(&mMutex);
+
+        mQuit = true;
+        mStopped.wakeAll();
+    }
+
+    wait();
+}
+
+void QLoggerConfigWatcher::run()
+{
+    QMutexLocker locker(&mMutex);
+
+    while (!mQuit)
+    {
+        locker.unlock();
+        check();
+        locker.relock();
+
+        QDeadlineTimer deadline(mInterval);
+
+        while (!mQuit && !deadline.hasExpired())
+            mStopped.wait(&mMutex, deadline);
+    }
+}
+
+void QLoggerConfigWatcher::check()
+{
+    const QFileInfo info(mPath);
+
+    if (!info.exists())
+        return;
+
+    const auto modified = info.lastModified();
+    const auto size     = info.size();
+
+    if (modified == mLastModified && size == mLastSize)
+        return;
+
+    mLastModified = modified;
+    mLastSize     = size;
+
+    LogConfig config;
+
+    if (LogConfig::read(mPath, config))
+        mApply(config);
+}
+
+}  // namespace QLogger
@@ -0,0 +1,101 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerLevel.h>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <functional>
+#include <optional>
+
+namespace QLogger
+{
+
+/**
+ * @brief The LogConfig struct holds the settings read from a config file. Only the keys present in the file are set.
+ */
+struct LogConfig
+{
+    std::optional<LogLevel> level;
+    std::optional<LogMode> mode;
+    std::optional<bool> paused;
+
+    /**
+    * @brief Level of each module.
+    */
+    QHash<QString, LogLevel> modules;
+
+    /**
+    * @brief read Reads a config file in INI format. The unknown keys and values are ignored.
+    * @param path The file.
+    * @param config The settings read.
+    * @return False if the file can't be read.
+    */
+    static bool read(const QString &path, LogConfig &config);
+};
+
+/**
+ * @brief The QLoggerConfigWatcher class checks a config file periodically in a thread of its own and reads it again
+ * when its modification time or its size changes. The first check reads it too.
+ */
+class QLoggerConfigWatcher : public QThread
+{
+public:
+    /**
+    * @brief Constructor that starts the thread.
+    * @param path The config file.
+    * @param interval The milliseconds between two checks.
+    * @param apply Called with the settings each time the file is read.
+    */
+    QLoggerConfigWatcher(const QString &path, int interval, std::function<void(const LogConfig &)> apply);
+
+    /**
+    * @brief Destructor that stops the thread.
+    */
+    ~QLoggerConfigWatcher() override;
+
+protected:
+    void run() override;
+
+private:
+    const QString mPath;
+    const int mInterval;
+    const std::function<void(const LogConfig &)> mApply;
+    QDateTime mLastModified;
+    qint64 mLastSize = -1;
+    QMutex mMutex;
+    QWaitCondition mStopped;
+    bool mQuit = false;
+
+    /**
+    * @brief check Reads the file if it changed since the last check.
+    */
+    void check();
+};
+
+}  // namespace QLogger
@@ -0,0 +1,81 @@
+#include "QLoggerConsole.h"
+
+#include <cstdio>
+
+namespace
+{
+/**
+ * @brief Gets the ANSI escape code of the color of a level.
+ */
+const char *levelColor(QLogger::LogLevel level)
+{
+    switch (level)
+    {
+        case QLogger::LogLevel::Trace:
+            return "\x1b[90m";
+        case QLogger::LogLevel::Debug:
+            return "\x1b[36m";
+        case QLogger::LogLevel::Info:
+            return "\x1b[32m";
+        case QLogger::LogLevel::Warning:
+            return "\x1b[33m";
+        case QLogger::LogLevel::Error:
+            return "\x1b[31m";
+        case QLogger::LogLevel::Fatal:
+            return "\x1b[1;31m";
+    }
+
+    return "";
+}
+
+const char RESET_COLOR[] = "\x1b[0m";
+}  // namespace
+
+namespace QLogger
+{
+
+QLoggerConsole *QLoggerConsole::getInstance()
+{
+    static QLoggerConsole INSTANCE;
+
+    return &INSTANCE;
+}
+
+QLoggerConsole::QLoggerConsole()
+{
+    // Unbuffered so that a batch is a single write() and nothing stays in a buffer at exit
+    mOutput.open(fileno(stdout), QIODevice::WriteOnly | QIODevice::Unbuffered);
+    mError.open(fileno(stderr), QIODevice::WriteOnly | QIODevice::Unbuffered);
+}
+
+void QLoggerConsole::appendLine(QByteArray &out, LogLevel level, const char *line, qsizetype size) const
+{
+    if (!hasColors())
+    {
+        out.append(line, size);
+        return;
+    }
+
+    // The reset goes before the new line so the color doesn't leak if the line is cut
+    const auto hasNewLine = size > 0 && line[size - 1] == '\n';
+
+    out.append(levelColor(level));
+    out.append(line, hasNewLine ? size - 1 : size);
+    out.append(RESET_COLOR);
+
+    if (hasNewLine)
+        out.append('\n');
+}
+
+void QLoggerConsole::write(const QByteArray &output, const QByteArray &error)
+{
+    QMutexLocker locker(&mMutex);
+
+    if (!output.isEmpty())
+        mOutput.write(output);
+
+    if (!error.isEmpty())
+        mError.write(error);
+}
+
+}  // namespace QLogger
@@ -0,0 +1,88 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QFile>
+#include <QLoggerLevel.h>
+#include <QMutex>
+
+#include <atomic>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerConsole class writes the batches of the writers in LogMode::OnlyConsole and LogMode::Full to the
+ * standard output and error, bypassing the Qt message handler. Each batch is written with one call per stream, under
+ * a lock so the batches of different writers don't mix.
+ */
+class QLoggerConsole
+{
+public:
+    /**
+    * @brief Gets the instance shared by all the writers.
+    */
+    static QLoggerConsole *getInstance();
+
+    /**
+    * @brief setColors Sets whether the lines are colored by level with ANSI escape codes.
+    */
+    void setColors(bool colors) { mColors.store(colors, std::memory_order_relaxed); }
+
+    /**
+    * @brief hasColors Whether the lines are colored by level.
+    */
+    bool hasColors() const { return mColors.load(std::memory_order_relaxed); }
+
+    /**
+    * @brief isError Whether the lines of the level go to the standard error.
+    */
+    static bool isError(LogLevel level) { return level >= LogLevel::Warning; }
+
+    /**
+    * @brief appendLine Appends a line at the end of a batch, colored if the colors are enabled.
+    * @param out The batch.
+    * @param level The level of the line.
+    * @param line The UTF-8 text of the line, ended by a new line.
+    * @param size The size of the line in bytes.
+    */
+    void appendLine(QByteArray &out, LogLevel level, const char *line, qsizetype size) const;
+
+    /**
+    * @brief write Writes the batches.
+    * @param output The lines for the standard output.
+    * @param error The lines for the standard error.
+    */
+    void write(const QByteArray &output, const QByteArray &error);
+
+private:
+    QMutex mMutex;
+    QFile mOutput;
+    QFile mError;
+    std::atomic<bool> mColors { false };
+
+    QLoggerConsole();
+};
+
+}  // namespace QLogger
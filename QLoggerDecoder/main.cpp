@@ -0,0 +1,136 @@
+/**
+ * @file main.cpp
+ *
+ * @brief Converts the files written by QLogger in LogMode::MemoryMapped or in LogFormat::Binary back to the text format
+ * of the log files.
+ *
+ * @module QLoggerDecoder
+ */
+#include <QCoreApplication>
+
+#include "QLoggerBinary.h"
+#include "QLoggerClock.h"
+#include "QLoggerRing.h"
+#include "QLoggerWriter.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QStringEncoder>
+
+using namespace QLogger;
+
+namespace
+{
+/**
+ * @brief Converts a comma separated list of LogMessageDisplay names.
+ */
+bool parseDisplay(const QString &text, LogMessageDisplays &options)
+{
+    static const QHash<QString, LogMessageDisplays> names {
+        { "level", LogMessageDisplay::LogLevel },  { "module", LogMessageDisplay::ModuleName },
+        { "datetime", LogMessageDisplay::DateTime }, { "threadid", LogMessageDisplay::ThreadId },
+        { "function", LogMessageDisplay::Function }, { "file", LogMessageDisplay::File },
+        { "line", LogMessageDisplay::Line },         { "message", LogMessageDisplay::Message },
+        { "json", LogMessageDisplay::Json },
+        { "default", LogMessageDisplay::Default },   { "default2", LogMessageDisplay::Default2 },
+        { "full", LogMessageDisplay::Full }
+    };
+
+    options = LogMessageDisplays();
+
+    for (const auto &name : text.split(','))
+    {
+        const auto iter = names.constFind(name.trimmed().toLower());
+
+        if (iter == names.constEnd())
+            return false;
+
+        options |= iter.value();
+    }
+
+    return true;
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts QLogger ring and binary files to text.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", "The ring or binary file to decode.");
+
+    const QCommandLineOption displayOption(
+        QStringList { "d", "display" },
+        "Elements of each line: level, module, datetime, threadid, function, file, line, message, json, default, "
+        "default2 or full, separated by commas.",
+        "elements", "default");
+    const QCommandLineOption outputOption(QStringList { "o", "output" }, "Writes the lines in <file> instead of the "
+                                                                          "standard output.",
+                                          "file");
+
+    parser.addOption(displayOption);
+    parser.addOption(outputOption);
+    parser.process(a);
+
+    const auto files = parser.positionalArguments();
+
+    LogMessageDisplays options;
+
+    if (files.size() != 1 || !parseDisplay(parser.value(displayOption), options))
+        parser.showHelp(1);
+
+    QFile input(files.constFirst());
+
+    if (!input.open(QIODevice::ReadOnly))
+    {
+        qCritical().noquote() << input.errorString();
+        return 1;
+    }
+
+    const auto isBinary = QLoggerBinary::isBinary(input.read(8));
+    input.close();
+
+    QString error;
+    const auto entries = isBinary ? QLoggerBinary::read(files.constFirst(), &error)
+                                  : QLoggerRing::read(files.constFirst(), &error);
+
+    // The records read before an error are still written
+    if (!error.isEmpty())
+        qCritical().noquote() << error;
+
+    QFile output;
+    auto opened = false;
+
+    if (parser.isSet(outputOption))
+    {
+        output.setFileName(parser.value(outputOption));
+        opened = output.open(QIODevice::WriteOnly | QIODevice::Text);
+    }
+    else
+        opened = output.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+
+    if (!opened)
+    {
+        qCritical().noquote() << output.errorString();
+        return 1;
+    }
+
+    QLoggerTimestamp timestamps;
+    QStringEncoder encoder(QStringEncoder::Utf8);
+
+    for (const auto &entry : entries)
+    {
+        const auto line = entry.formatted
+            ? entry.message
+            : QLoggerWriter::formatLine(options, LogLevel::Trace, timestamps.format(entry.msecsSinceEpoch),
+                                        entry.threadId, entry.module, entry.level, entry.function, entry.file, entry.line,
+                                        entry.message, entry.fields);
+
+        const QByteArray bytes = encoder.encode(line);
+        output.write(bytes);
+    }
+
+    return error.isEmpty() ? 0 : 1;
+}
@@ -41,6 +41,32 @@ enum class LogLevel
    Fatal
 };
 
+/**
+ * @brief Level value used by the lock-free level checks for destinations that don't write any message.
+ */
+constexpr int DISABLED_LEVEL = static_cast<int>(LogLevel::Fatal) + 1;
+
+/**
+ * @brief QLOGGER_MIN_LEVEL is the lowest level that is built in the QLog_* macros, from 0 (Trace) to 5 (Fatal). The
+ * calls below it are removed at compile time and their arguments are not evaluated. A value of 6 removes all of them.
+ */
+#ifndef QLOGGER_MIN_LEVEL
+#    define QLOGGER_MIN_LEVEL 0
+#endif
+
+static_assert(QLOGGER_MIN_LEVEL >= 0 && QLOGGER_MIN_LEVEL <= DISABLED_LEVEL,
+              "QLOGGER_MIN_LEVEL must be between 0 (Trace) and 6 (none)");
+
+/**
+ * @brief isCompiledLevel Checks at compile time if the messages of the given level are built.
+ * @param level The level of the message.
+ * @return True if the level is not below QLOGGER_MIN_LEVEL.
+ */
+constexpr bool isCompiledLevel(LogLevel level)
+{
+    return static_cast<int>(level) >= QLOGGER_MIN_LEVEL;
+}
+
 /**
  * @brief The LogMode enum class defines the way to display the log message.
  */
@@ -49,7 +75,75 @@ enum class LogMode
     Disabled = 0,
     OnlyConsole,
     OnlyFile,
-    Full
+    Full,
+    MemoryMapped  //! Records copied in a memory-mapped ring file, see QLoggerRing. It survives a crash of the process.
+};
+
+/**
+ * @brief The LogOverflowPolicy enum class defines what happens with a new message when the queue of a destination is
+ * full.
+ */
+enum class LogOverflowPolicy
+{
+    Block,       //! The producer waits until the writer frees space.
+    DropOldest,  //! The oldest message of the queue is discarded.
+    DropNewest,  //! The new message is discarded.
+    Sample       //! One in N new messages is kept, discarding the oldest one. The rest are discarded.
+};
+
+/**
+ * @brief The LogFormat enum class defines how the messages are stored in the log file.
+ */
+enum class LogFormat
+{
+    Text,   //! Lines built with the LogMessageDisplay options.
+    Binary  //! Compact records with the names written once per file, see QLoggerBinary.
+};
+
+/**
+ * @brief The LogRateScope enum class defines what shares the budget of a rate limit.
+ */
+enum class LogRateScope
+{
+    CallSite,  //! Every QLog_* line has its own budget.
+    Module     //! All the messages of the module and level share the budget.
+};
+
+/**
+ * @brief The LogStatsFormat enum class defines how the stats are exported periodically.
+ */
+enum class LogStatsFormat
+{
+    Text,       //! Info messages of a module, one per destination.
+    Prometheus  //! A file in the Prometheus text format, replaced atomically, as read by the textfile collector.
+};
+
+/**
+ * @brief The LogProtocol enum class defines the transport of a QLoggerNetworkSink.
+ */
+enum class LogProtocol
+{
+    Udp,  //! Datagrams with as many messages as fit, separated by new lines.
+    Tcp   //! One stream, reconnected in the background when it is lost.
+};
+
+/**
+ * @brief The LogNetworkFormat enum class defines the messages sent by a QLoggerNetworkSink.
+ */
+enum class LogNetworkFormat
+{
+    Syslog,  //! RFC 5424 messages, framed by octet counting over TCP.
+    Lines    //! The lines of the destination, as in the file.
+};
+
+/**
+ * @brief The LogCompression enum class defines how the rotated log files are compressed.
+ */
+enum class LogCompression
+{
+    None,
+    SevenZip,  //! .7z archive made by the external 7z program. The original file is kept.
+    Gzip       //! .gz file made in-process. It replaces the original file.
 };
 
 /**
@@ -74,6 +168,7 @@ enum class LogMessageDisplay : unsigned int
     File          = 1<<5,
     Line          = 1<<6,
     Message       = 1<<7,
+    Json          = 1<<8,  //! Each line is a JSON object with the elements selected and the fields of the message.
 
     Default       = LogLevel|ModuleName|DateTime|ThreadId|File|Line|Message,
     Default2      = LogLevel|ModuleName|DateTime|ThreadId|File|Function|Message,
@@ -0,0 +1,305 @@
+#include "QLoggerNetworkSink.h"
+
+#include "QLoggerClock.h"
+#include "QLoggerWriter.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QHostAddress>
+#include <QHostInfo>
+#include <QSysInfo>
+#include <QTcpSocket>
+#include <QUdpSocket>
+
+#include <memory>
+
+namespace
+{
+/**
+ * @brief Milliseconds to connect or to send before the collector is considered unreachable.
+ */
+const int SOCKET_TIMEOUT = 3000;
+
+/**
+ * @brief Maximum time in milliseconds between two attempts to reach the collector.
+ */
+const int MAX_RECONNECT_INTERVAL = 30000;
+
+/**
+ * @brief Shortens a UTF-8 text to at most size bytes without cutting a character in half.
+ */
+void truncateUtf8(QByteArray &text, qsizetype size)
+{
+    if (text.size() <= size)
+        return;
+
+    // The first byte left out must not be a continuation byte (10xxxxxx) of the last character kept
+    while (size > 0 && (static_cast<uchar>(text.at(size)) & 0xC0) == 0x80)
+        --size;
+
+    text.truncate(size);
+}
+
+/**
+ * @brief Converts a level in a syslog severity.
+ */
+int syslogSeverity(QLogger::LogLevel level)
+{
+    switch (level)
+    {
+        case QLogger::LogLevel::Trace:
+        case QLogger::LogLevel::Debug:
+            return 7;
+        case QLogger::LogLevel::Info:
+            return 6;
+        case QLogger::LogLevel::Warning:
+            return 4;
+        case QLogger::LogLevel::Error:
+            return 3;
+        case QLogger::LogLevel::Fatal:
+            return 2;
+    }
+
+    return 6;
+}
+
+/**
+ * @brief Converts a text in a syslog header field: printable, without spaces and "-" if it is empty.
+ */
+QString headerField(QString text, int maxLength)
+{
+    text = text.left(maxLength);
+
+    for (auto &c : text)
+    {
+        if (c.unicode() <= ' ' || c.unicode() > '~')
+            c = QLatin1Char('_');
+    }
+
+    return text.isEmpty() ? QStringLiteral("-") : text;
+}
+}  // namespace
+
+namespace QLogger
+{
+
+QLoggerNetworkSink::QLoggerNetworkSink(const QString &host, quint16 port, LogProtocol protocol, LogNetworkFormat format)
+    : mHost(host)
+    , mPort(port)
+    , mProtocol(protocol)
+    , mFormat(format)
+    , mHostName(headerField(QSysInfo::machineHostName(), 255))
+    , mAppName(headerField(QCoreApplication::applicationName(), 48))
+    , mProcessId(QString::number(QCoreApplication::applicationPid()))
+{
+    start(QThread::LowPriority);
+}
+
+QLoggerNetworkSink::~QLoggerNetworkSink()
+{
+    {
+        QMutexLocker locker(&mMutex);
+
+        mQuit = true;
+        mPacketsAvailable.wakeAll();
+    }
+
+    wait();
+}
+
+void QLoggerNetworkSink::write(QLoggerWriter &writer, const QVector<LogRecord> &records)
+{
+    QVector<Packet> packets;
+    Packet packet;
+
+    for (const auto &record : records)
+    {
+        auto message = formatMessage(writer, record);
+
+        // A datagram holds as many whole messages as fit, over TCP the batch is a single write
+        if (mProtocol == LogProtocol::Udp)
+        {
+            if (message.size() > mMaxDatagramSize)
+            {
+                truncateUtf8(message, mMaxDatagramSize - 1);
+                message.append('\n');
+            }
+
+            if (!packet.data.isEmpty() && packet.data.size() + message.size() > mMaxDatagramSize)
+            {
+                packets.append(std::move(packet));
+                packet = Packet();
+            }
+        }
+
+        packet.data.append(message);
+        ++packet.messages;
+    }
+
+    if (packet.messages > 0)
+        packets.append(std::move(packet));
+
+    enqueue(packets);
+}
+
+QByteArray QLoggerNetworkSink::formatMessage(QLoggerWriter &writer, const LogRecord &record) const
+{
+    if (mFormat == LogNetworkFormat::Lines)
+        return writer.formatRecord(record).toUtf8();
+
+    const auto msecs   = QLoggerClock::toMSecsSinceEpoch(record.timestamp);
+    const auto time    = QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC).toString(Qt::ISODateWithMs);
+    const auto module  = record.module ? headerField(*record.module, 32) : QStringLiteral("-");
+    const auto text    = record.module ? record.message + QLoggerWriter::formatFields(record.fields)
+                                       : record.message.trimmed();
+    const auto message = QString("<%1>1 %2 %3 %4 %5 %6 - %7")
+                             .arg(QString::number(mFacility * 8 + syslogSeverity(record.level)), time, mHostName,
+                                  mAppName, mProcessId, module, text)
+                             .toUtf8();
+
+    // RFC 6587 octet counting over TCP, one message per line over UDP
+    if (mProtocol == LogProtocol::Tcp)
+        return QByteArray::number(static_cast<qint64>(message.size())) + ' ' + message;
+
+    return message + '\n';
+}
+
+void QLoggerNetworkSink::enqueue(QVector<Packet> &packets)
+{
+    QMutexLocker locker(&mMutex);
+
+    for (auto &packet : packets)
+    {
+        if (mQuit || (mMaxQueueBytes > 0 && mQueuedBytes + packet.data.size() > mMaxQueueBytes))
+        {
+            mDroppedMessages.fetch_add(packet.messages, std::memory_order_relaxed);
+            continue;
+        }
+
+        mQueuedBytes += packet.data.size();
+        mPackets.push_back(std::move(packet));
+    }
+
+    mPacketsAvailable.wakeOne();
+}
+
+void QLoggerNetworkSink::run()
+{
+    // The socket belongs to this thread
+    std::unique_ptr<QAbstractSocket> socket;
+
+    if (mProtocol == LogProtocol::Udp)
+        socket = std::make_unique<QUdpSocket>();
+    else
+        socket = std::make_unique<QTcpSocket>();
+
+    QHostAddress address;
+    auto retryInterval = mReconnectInterval.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        Packet packet;
+
+        {
+            QMutexLocker locker(&mMutex);
+
+            while (mPackets.empty() && !mQuit)
+                mPacketsAvailable.wait(&mMutex);
+
+            if (mPackets.empty())
+                break;
+
+            packet = std::move(mPackets.front());
+            mPackets.pop_front();
+            mQueuedBytes -= packet.data.size();
+        }
+
+        // The packet is kept until the collector is back, the new ones are discarded if the queue fills meanwhile
+        while (!send(*socket, address, packet.data))
+        {
+            if (!waitToRetry(retryInterval))
+            {
+                QMutexLocker locker(&mMutex);
+
+                for (const auto &pending : mPackets)
+                    mDroppedMessages.fetch_add(pending.messages, std::memory_order_relaxed);
+
+                mDroppedMessages.fetch_add(packet.messages, std::memory_order_relaxed);
+                mPackets.clear();
+                mQueuedBytes = 0;
+
+                return;
+            }
+
+            retryInterval = qMin(retryInterval * 2, MAX_RECONNECT_INTERVAL);
+        }
+
+        retryInterval = mReconnectInterval.load(std::memory_order_relaxed);
+    }
+
+    if (mProtocol == LogProtocol::Tcp && socket->state() == QAbstractSocket::ConnectedState)
+    {
+        socket->disconnectFromHost();
+
+        if (socket->state() != QAbstractSocket::UnconnectedState)
+            socket->waitForDisconnected(SOCKET_TIMEOUT);
+    }
+}
+
+bool QLoggerNetworkSink::send(QAbstractSocket &socket, QHostAddress &address, const QByteArray &data)
+{
+    if (mProtocol == LogProtocol::Udp)
+    {
+        if (address.isNull() && !address.setAddress(mHost))
+        {
+            const auto addresses = QHostInfo::fromName(mHost).addresses();
+
+            if (addresses.isEmpty())
+                return false;
+
+            address = addresses.constFirst();
+        }
+
+        return static_cast<QUdpSocket &>(socket).writeDatagram(data, address, mPort) == data.size();
+    }
+
+    if (socket.state() != QAbstractSocket::ConnectedState)
+    {
+        socket.abort();
+        socket.connectToHost(mHost, mPort, QIODevice::WriteOnly);
+
+        if (!socket.waitForConnected(SOCKET_TIMEOUT))
+            return false;
+    }
+
+    if (socket.write(data) != data.size())
+    {
+        socket.abort();
+        return false;
+    }
+
+    while (socket.bytesToWrite() > 0)
+    {
+        if (!socket.waitForBytesWritten(SOCKET_TIMEOUT))
+        {
+            socket.abort();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool QLoggerNetworkSink::waitToRetry(int msecs)
+{
+    QMutexLocker locker(&mMutex);
+    QDeadlineTimer deadline(msecs);
+
+    while (!mQuit && !deadline.hasExpired())
+        mPacketsAvailable.wait(&mMutex, deadline);
+
+    return !mQuit;
+}
+
+}  // namespace QLogger
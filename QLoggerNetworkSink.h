@@ -0,0 +1,154 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QLoggerLevel.h>
+#include <QLoggerSink.h>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <deque>
+
+class QAbstractSocket;
+class QHostAddress;
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerNetworkSink class sends the messages of its destinations to a syslog or line-protocol collector.
+ * The writer threads only format the batches in packets, the sending and the reconnections are done by the thread of
+ * the sink. Its queue is bounded: while the collector is unreachable the new packets are discarded instead of
+ * stalling the destinations.
+ */
+class QLoggerNetworkSink : public QThread, public QLoggerSink
+{
+public:
+    /**
+    * @brief Constructor that starts the thread of the sink. The host is resolved by that thread.
+    * @param host The name or address of the collector.
+    * @param port The port of the collector.
+    * @param protocol The transport.
+    * @param format The format of the messages.
+    */
+    QLoggerNetworkSink(const QString &host, quint16 port, LogProtocol protocol = LogProtocol::Udp, LogNetworkFormat format = LogNetworkFormat::Syslog);
+
+    /**
+    * @brief Destructor that sends what is queued and stops the thread. The queue is discarded if the collector is
+    * unreachable.
+    */
+    ~QLoggerNetworkSink() override;
+
+    /**
+    * @brief setMaxDatagramSize Sets the maximum size of a UDP datagram. Longer messages are truncated. It must be
+    * called before the sink is added to a destination.
+    */
+    void setMaxDatagramSize(int size) { mMaxDatagramSize = qMax(size, 64); }
+
+    /**
+    * @brief setMaxQueueBytes Sets the memory used by the packets waiting to be sent. It must be called before the sink
+    * is added to a destination.
+    */
+    void setMaxQueueBytes(qint64 maxBytes) { mMaxQueueBytes = maxBytes; }
+
+    /**
+    * @brief setFacility Sets the syslog facility of the messages, 1 (user) by default. It must be called before the
+    * sink is added to a destination.
+    */
+    void setFacility(int facility) { mFacility = qBound(0, facility, 23); }
+
+    /**
+    * @brief setReconnectInterval Sets the time in milliseconds before trying to reach the collector again. It doubles
+    * after every failure, up to 30 seconds.
+    */
+    void setReconnectInterval(int msecs) { mReconnectInterval.store(qMax(msecs, 1), std::memory_order_relaxed); }
+
+    /**
+    * @brief droppedMessages Gets the number of messages discarded because the queue was full or the collector was
+    * unreachable.
+    */
+    quint64 droppedMessages() const { return mDroppedMessages.load(std::memory_order_relaxed); }
+
+    void write(QLoggerWriter &writer, const QVector<LogRecord> &records) override;
+
+protected:
+    void run() override;
+
+private:
+    struct Packet
+    {
+        QByteArray data;
+        int messages = 0;
+    };
+
+    const QString mHost;
+    const quint16 mPort;
+    const LogProtocol mProtocol;
+    const LogNetworkFormat mFormat;
+    int mMaxDatagramSize = 1400;
+    qint64 mMaxQueueBytes = 4 * 1024 * 1024;
+    int mFacility = 1;
+    std::atomic<int> mReconnectInterval { 1000 };
+    std::atomic<quint64> mDroppedMessages { 0 };
+
+    /**
+    * @brief The fields of the syslog header that don't change, with "-" when they are unknown.
+    */
+    QString mHostName;
+    QString mAppName;
+    QString mProcessId;
+
+    QMutex mMutex;
+    QWaitCondition mPacketsAvailable;
+    std::deque<Packet> mPackets;
+    qint64 mQueuedBytes = 0;
+    bool mQuit = false;
+
+    /**
+    * @brief formatMessage Builds the bytes of a message in the format of the sink, with its framing.
+    */
+    QByteArray formatMessage(QLoggerWriter &writer, const LogRecord &record) const;
+
+    /**
+    * @brief enqueue Moves the packets of a batch to the queue, discarding those that don't fit.
+    */
+    void enqueue(QVector<Packet> &packets);
+
+    /**
+    * @brief send Sends a packet, connecting the socket if needed.
+    * @return False if the collector can't be reached.
+    */
+    bool send(QAbstractSocket &socket, QHostAddress &address, const QByteArray &data);
+
+    /**
+    * @brief waitToRetry Waits before the next attempt to send.
+    * @return False if the sink is destroyed meanwhile.
+    */
+    bool waitToRetry(int msecs);
+};
+
+}  // namespace QLogger
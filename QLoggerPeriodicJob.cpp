@@ -0,0 +1,47 @@
+#include "QLoggerPeriodicJob.h"
+
+#include <QDeadlineTimer>
+
+namespace QLogger
+{
+
+QLoggerPeriodicJob::QLoggerPeriodicJob(int interval, std::function<void()> job)
+    : mInterval(qMax(interval, 1))
+    , mJob(std::move(job))
+{
+    start(QThread::LowPriority);
+}
+
+QLoggerPeriodicJob::~QLoggerPeriodicJob()
+{
+    {
+        QMutexLocker locker(&mMutex);
+
+        mQuit = true;
+        mStopped.wakeAll();
+    }
+
+    wait();
+}
+
+void QLoggerPeriodicJob::run()
+{
+    QMutexLocker locker(&mMutex);
+
+    while (!mQuit)
+    {
+        QDeadlineTimer deadline(mInterval);
+
+        while (!mQuit && !deadline.hasExpired())
+            mStopped.wait(&mMutex, deadline);
+
+        if (mQuit)
+            break;
+
+        locker.unlock();
+        mJob();
+        locker.relock();
+    }
+}
+
+}  // namespace QLogger
@@ -0,0 +1,64 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <functional>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerPeriodicJob class runs a job periodically in a thread of its own, as the report of the messages
+ * suppressed by the rate limits or the export of the stats.
+ */
+class QLoggerPeriodicJob : public QThread
+{
+public:
+    /**
+    * @brief Constructor that starts the thread.
+    * @param interval The milliseconds between two runs of the job.
+    * @param job The job.
+    */
+    QLoggerPeriodicJob(int interval, std::function<void()> job);
+
+    /**
+    * @brief Destructor that stops the thread without a last run.
+    */
+    ~QLoggerPeriodicJob() override;
+
+protected:
+    void run() override;
+
+private:
+    const int mInterval;
+    const std::function<void()> mJob;
+    QMutex mMutex;
+    QWaitCondition mStopped;
+    bool mQuit = false;
+};
+
+}  // namespace QLogger
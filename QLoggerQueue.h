@@ -0,0 +1,177 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerQueue class is a bounded, lock-free, multi-producer multi-consumer ring buffer. Every slot carries
+ * a sequence number that tells producers and consumers whether the slot is free or holds a value, so pushing and
+ * popping only needs a compare-and-swap on the shared position plus one release store on the slot.
+ */
+template<typename T>
+class QLoggerQueue
+{
+public:
+    /**
+    * @brief Constructor that allocates the ring buffer.
+    * @param capacity The minimum number of elements the queue can store. It is rounded up to a power of two.
+    */
+    explicit QLoggerQueue(qsizetype capacity)
+    {
+        quint64 size = 2;
+
+        while (size < static_cast<quint64>(capacity))
+            size <<= 1;
+
+        mMask  = size - 1;
+        mCells = std::make_unique<Cell[]>(size);
+
+        for (quint64 i = 0; i < size; ++i)
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    QLoggerQueue(const QLoggerQueue &) = delete;
+    QLoggerQueue &operator=(const QLoggerQueue &) = delete;
+
+    /**
+    * @brief tryPush Moves the value in the queue.
+    * @param value The value to store. It is left untouched if the queue is full.
+    * @param position If not null, receives the position of the value in the queue. Positions grow by one with every
+    * value pushed.
+    * @return True if the value was stored, false if the queue is full.
+    */
+    bool tryPush(T &&value, quint64 *position = nullptr)
+    {
+        auto pos = mEnqueuePos.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            auto &cell     = mCells[pos & mMask];
+            const auto seq = cell.sequence.load(std::memory_order_acquire);
+            const auto dif = static_cast<qint64>(seq) - static_cast<qint64>(pos);
+
+            if (dif == 0)
+            {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+
+                    if (position)
+                        *position = pos;
+
+                    return true;
+                }
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+    * @brief tryPop Takes the oldest value of the queue.
+    * @param value The destination of the value.
+    * @return True if a value was taken, false if the queue is empty.
+    */
+    bool tryPop(T &value)
+    {
+        auto pos = mDequeuePos.load(std::memory_order_relaxed);
+
+        for (;;)
+        {
+            auto &cell     = mCells[pos & mMask];
+            const auto seq = cell.sequence.load(std::memory_order_acquire);
+            const auto dif = static_cast<qint64>(seq) - static_cast<qint64>(pos + 1);
+
+            if (dif == 0)
+            {
+                if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(pos + mMask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+                return false;
+            else
+                pos = mDequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+    * @brief size Gets the number of elements in the queue. The value is approximate while other threads are pushing
+    * or popping.
+    */
+    qsizetype size() const
+    {
+        const auto enqueued = mEnqueuePos.load(std::memory_order_relaxed);
+        const auto dequeued = mDequeuePos.load(std::memory_order_relaxed);
+
+        return enqueued > dequeued ? static_cast<qsizetype>(enqueued - dequeued) : 0;
+    }
+
+    /**
+    * @brief enqueuePosition Gets the position of the next value to push.
+    */
+    quint64 enqueuePosition() const { return mEnqueuePos.load(std::memory_order_acquire); }
+
+    /**
+    * @brief dequeuePosition Gets the position of the next value to pop. Every value before it has been popped.
+    */
+    quint64 dequeuePosition() const { return mDequeuePos.load(std::memory_order_acquire); }
+
+    /**
+    * @brief isEmpty Whether the queue is empty or not. The value is approximate.
+    */
+    bool isEmpty() const { return size() == 0; }
+
+    /**
+    * @brief capacity Gets the maximum number of elements of the queue.
+    */
+    qsizetype capacity() const { return static_cast<qsizetype>(mMask + 1); }
+
+private:
+    struct Cell
+    {
+        std::atomic<quint64> sequence { 0 };
+        T value;
+    };
+
+    alignas(64) std::atomic<quint64> mEnqueuePos { 0 };
+    alignas(64) std::atomic<quint64> mDequeuePos { 0 };
+    alignas(64) quint64 mMask = 0;
+    std::unique_ptr<Cell[]> mCells;
+};
+
+}  // namespace QLogger
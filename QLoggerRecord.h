@@ -0,0 +1,182 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerLevel.h>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+namespace QLogger
+{
+
+/**
+ * @brief The LogField struct is a key/value pair of a structured message. The value is captured as it is and only
+ * converted to text by the writer thread.
+ */
+struct LogField
+{
+    /**
+    * @brief The key. It must be a string literal or live as long as the QLoggerManager.
+    */
+    const char *key = "";
+    QVariant value;
+};
+
+using LogFields = QVector<LogField>;
+
+inline void appendFields(LogFields &) { }
+
+template<typename T, typename... Args>
+void appendFields(LogFields &fields, const char *key, T &&value, Args &&...args)
+{
+    // String literals are not stored in QVariant as char pointers
+    if constexpr (std::is_convertible_v<T, const char *>)
+        fields.append({ key, QString::fromUtf8(value) });
+    else
+        fields.append({ key, QVariant::fromValue(std::forward<T>(value)) });
+
+    appendFields(fields, std::forward<Args>(args)...);
+}
+
+/**
+ * @brief makeFields Builds the fields of a structured message.
+ * @param args Pairs of key and value: "key1", value1, "key2", value2...
+ */
+template<typename... Args>
+LogFields makeFields(Args &&...args)
+{
+    static_assert(sizeof...(Args) % 2 == 0, "The fields are pairs of key and value");
+
+    LogFields fields;
+    fields.reserve(sizeof...(Args) / 2);
+    appendFields(fields, std::forward<Args>(args)...);
+
+    return fields;
+}
+
+/**
+ * @brief fileBaseName Gets the name of the file of a path, without the folders. It can be evaluated at compile time.
+ */
+constexpr const char *fileBaseName(const char *path)
+{
+    auto fileName = path;
+
+    for (auto iter = path; *iter; ++iter)
+    {
+        if (*iter == '/' || *iter == '\\')
+            fileName = iter + 1;
+    }
+
+    return fileName;
+}
+
+/**
+ * @brief The LogRateState struct is the budget of a rate limit, as a token bucket kept in one atomic: the tick at which
+ * the bucket is full again. The suppressed messages are counted until they are reported, and pending tells that the
+ * state is in the list of the states checked by the manager.
+ */
+struct LogRateState
+{
+    std::atomic<qint64> fullTick { 0 };
+    std::atomic<quint64> suppressed { 0 };
+    std::atomic<bool> pending { false };
+};
+
+/**
+ * @brief The LogCallSite struct is the metadata of the place that logs. The QLog_* macros define one static constant
+ * per call site, so a message only carries a pointer to it.
+ */
+struct LogCallSite
+{
+    /**
+    * @brief The function that logs.
+    */
+    const char *function = "";
+    /**
+    * @brief The name of the file that logs, without the folders.
+    */
+    const char *file = "";
+    int line = -1;
+    LogLevel level = LogLevel::Trace;
+    /**
+    * @brief The budget of the call site when its module has a rate limit per call site.
+    */
+    LogRateState *rate = nullptr;
+};
+
+/**
+ * @brief The call site of the messages that don't come from a macro.
+ */
+inline constexpr LogCallSite NO_CALL_SITE {};
+
+/**
+ * @brief The LogRecord struct is what the producers enqueue in a QLoggerWriter. It only holds raw values: the text of
+ * the line is built by the writer thread. The module and the call site are interned and live as long as the
+ * QLoggerManager, so copying a record never allocates.
+ */
+struct LogRecord
+{
+    /**
+    * @brief Tick of QLoggerClock when the message was logged.
+    */
+    qint64 timestamp = 0;
+    /**
+    * @brief Identifier of the thread that logged the message.
+    */
+    quintptr threadId = 0;
+    LogLevel level = LogLevel::Trace;
+    /**
+    * @brief Name of the module. If it is null the message is an already formatted line.
+    */
+    const QString *module = nullptr;
+    const LogCallSite *site = &NO_CALL_SITE;
+    QString message;
+    LogFields fields;
+};
+
+/**
+ * @brief The LogEntry struct is a record read back from a file written in a binary format, with the strings resolved.
+ */
+struct LogEntry
+{
+    qint64 msecsSinceEpoch = 0;
+    QString threadId;
+    LogLevel level = LogLevel::Trace;
+    /**
+    * @brief Whether message is an already formatted line.
+    */
+    bool formatted = false;
+    QString module;
+    QString function;
+    QString file;
+    int line = -1;
+    QString message;
+    LogFields fields;
+};
+
+}  // namespace QLogger
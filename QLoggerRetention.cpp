@@ -0,0 +1,351 @@
+#include "QLoggerRetention.h"
+
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+#include <utility>
+
+namespace
+{
+constexpr qint64 MSECS_PER_DAY = 24 * 3600 * 1000;
+
+/**
+ * @brief Gets the size of the files that exist.
+ */
+qint64 filesSize(const QStringList &paths)
+{
+    qint64 size = 0;
+
+    for (const auto &path : paths)
+    {
+        const QFileInfo info(path);
+
+        if (info.exists())
+            size += info.size();
+    }
+
+    return size;
+}
+}  // namespace
+
+namespace QLogger
+{
+
+QLoggerRetention *QLoggerRetention::getInstance()
+{
+    static QLoggerRetention INSTANCE;
+
+    return &INSTANCE;
+}
+
+QLoggerRetention::QLoggerRetention() = default;
+
+QLoggerRetention::~QLoggerRetention()
+{
+    {
+        QMutexLocker locker(&mMutex);
+
+        mQuit = true;
+        mChanged.wakeAll();
+    }
+
+    wait();
+}
+
+void QLoggerRetention::setPolicy(const QString &destination, const LogRetention &retention)
+{
+    QMutexLocker locker(&mMutex);
+
+    if (!retention.isEnabled())
+    {
+        mDestinations.remove(destination);
+        return;
+    }
+
+    mDestinations[destination].policy = retention;
+
+    startThread();
+
+    mPending = true;
+    mChanged.wakeAll();
+}
+
+void QLoggerRetention::track(const QString &destination, const QStringList &paths, bool compressing)
+{
+    RotatedFile file;
+    file.paths       = paths;
+    file.size        = filesSize(paths);
+    file.time        = QDateTime::currentMSecsSinceEpoch();
+    file.compressing = compressing;
+
+    QMutexLocker locker(&mMutex);
+
+    const auto iter = mDestinations.find(destination);
+
+    if (iter == mDestinations.end())
+        return;
+
+    iter->totalBytes += file.size;
+    iter->files.push_back(std::move(file));
+
+    mPending = true;
+    mChanged.wakeAll();
+}
+
+void QLoggerRetention::compressed(const QString &path)
+{
+    QStringList paths;
+
+    {
+        QMutexLocker locker(&mMutex);
+
+        if (const auto file = findCompressing(path))
+            paths = file->paths;
+    }
+
+    if (paths.isEmpty())
+        return;
+
+    // The sizes are read without the lock, the file stays in the list while it is compressing
+    const auto size = filesSize(paths);
+
+    QMutexLocker locker(&mMutex);
+
+    // The destination may have lost its policy meanwhile
+    QString destination;
+
+    if (const auto file = findCompressing(path, &destination))
+    {
+        mDestinations[destination].totalBytes += size - file->size;
+        file->size        = size;
+        file->compressing = false;
+
+        mPending = true;
+        mChanged.wakeAll();
+    }
+}
+
+QLoggerRetention::RotatedFile *QLoggerRetention::findCompressing(const QString &path, QString *destination)
+{
+    for (auto iter = mDestinations.begin(); iter != mDestinations.end(); ++iter)
+    {
+        // The file was rotated a moment ago: it is at the end of its list
+        for (auto file = iter->files.rbegin(); file != iter->files.rend(); ++file)
+        {
+            if (file->compressing && file->paths.constFirst() == path)
+            {
+                if (destination)
+                    *destination = iter.key();
+
+                return &*file;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void QLoggerRetention::clearFolder(const QString &folder, int days, const QStringList &filters)
+{
+    QMutexLocker locker(&mMutex);
+
+    mSweeps.append({ folder, days, filters });
+
+    startThread();
+
+    mPending = true;
+    mChanged.wakeAll();
+}
+
+void QLoggerRetention::startThread()
+{
+    if (!mStarted)
+    {
+        mStarted = true;
+        start(QThread::LowPriority);
+    }
+}
+
+void QLoggerRetention::run()
+{
+    QMutexLocker locker(&mMutex);
+
+    while (!mQuit)
+    {
+        mPending = false;
+
+        QStringList unlisted;
+
+        for (auto iter = mDestinations.begin(); iter != mDestinations.end(); ++iter)
+        {
+            if (!iter->listed)
+            {
+                iter->listed = true;
+                unlisted.append(iter.key());
+            }
+        }
+
+        const auto sweeps = std::exchange(mSweeps, QVector<Sweep>());
+
+        // The folders are listed without the lock, so the writers can track their rotations meanwhile
+        if (!unlisted.isEmpty() || !sweeps.isEmpty())
+        {
+            locker.unlock();
+
+            QHash<QString, std::deque<RotatedFile>> found;
+
+            for (const auto &destination : qAsConst(unlisted))
+                found.insert(destination, list(destination));
+
+            for (const auto &folderSweep : sweeps)
+                sweep(folderSweep);
+
+            locker.relock();
+
+            for (auto iter = found.cbegin(); iter != found.cend(); ++iter)
+            {
+                const auto destination = mDestinations.find(iter.key());
+
+                if (destination == mDestinations.end())
+                    continue;
+
+                QSet<QString> tracked;
+
+                for (const auto &file : destination->files)
+                {
+                    for (const auto &path : file.paths)
+                        tracked.insert(path);
+                }
+
+                // The files found are older than the ones tracked since the policy was set
+                const auto &older = iter.value();
+
+                for (auto file = older.crbegin(); file != older.crend(); ++file)
+                {
+                    if (tracked.contains(file->paths.constFirst()))
+                        continue;
+
+                    destination->totalBytes += file->size;
+                    destination->files.push_front(*file);
+                }
+            }
+        }
+
+        const auto now = QDateTime::currentMSecsSinceEpoch();
+        qint64 next    = 0;
+        const auto expired = takeExpired(now, next);
+
+        if (!expired.isEmpty())
+        {
+            locker.unlock();
+
+            for (const auto &path : expired)
+                QFile::remove(path);
+
+            locker.relock();
+        }
+
+        if (mQuit || mPending)
+            continue;
+
+        if (next > 0)
+            mChanged.wait(&mMutex, QDeadlineTimer(qMax(next - now, qint64(1))));
+        else
+            mChanged.wait(&mMutex);
+    }
+}
+
+std::deque<QLoggerRetention::RotatedFile> QLoggerRetention::list(const QString &destination)
+{
+    const QFileInfo info(destination);
+    const auto base = info.completeBaseName();
+
+    // The names of renameFileIfFull and of the compressed files, oldest first
+    QDir dir(info.absolutePath());
+    dir.setNameFilters({ base + "_*", base + "(*" });
+
+    const auto entries
+        = dir.entryInfoList(QDir::Files | QDir::Hidden | QDir::NoSymLinks, QDir::Time | QDir::Reversed);
+
+    std::deque<RotatedFile> files;
+
+    for (const auto &entry : entries)
+    {
+        if (entry.absoluteFilePath() == info.absoluteFilePath())
+            continue;
+
+        RotatedFile file;
+        file.paths.append(entry.absoluteFilePath());
+        file.size = entry.size();
+        file.time = entry.lastModified().toMSecsSinceEpoch();
+
+        files.push_back(std::move(file));
+    }
+
+    return files;
+}
+
+void QLoggerRetention::sweep(const Sweep &sweep)
+{
+    QDir dir(sweep.folder);
+
+    if (!dir.exists())
+        return;
+
+    dir.setFilter(QDir::Files | QDir::Hidden | QDir::NoSymLinks);
+    dir.setNameFilters(sweep.filters);
+
+    const auto list = dir.entryInfoList();
+    const auto now  = QDateTime::currentDateTime();
+
+    for (const auto &fileInfoIter : list)
+    {
+        if (fileInfoIter.lastModified().daysTo(now) >= sweep.days)
+            dir.remove(fileInfoIter.fileName());
+    }
+}
+
+QStringList QLoggerRetention::takeExpired(qint64 now, qint64 &next)
+{
+    QStringList expired;
+
+    for (auto iter = mDestinations.begin(); iter != mDestinations.end(); ++iter)
+    {
+        auto &destination  = *iter;
+        const auto &policy = destination.policy;
+        const auto maxAge  = qint64(policy.maxDays) * MSECS_PER_DAY;
+
+        while (!destination.files.empty())
+        {
+            const auto &oldest = destination.files.front();
+
+            const auto tooMany = policy.maxFiles > 0 && destination.files.size() > static_cast<size_t>(policy.maxFiles);
+            const auto tooBig  = policy.maxBytes > 0 && destination.totalBytes > policy.maxBytes;
+            const auto tooOld  = maxAge > 0 && now - oldest.time >= maxAge;
+
+            if (!tooMany && !tooBig && !tooOld)
+            {
+                if (maxAge > 0)
+                    next = next == 0 ? oldest.time + maxAge : qMin(next, oldest.time + maxAge);
+
+                break;
+            }
+
+            // A file is deleted once its compression is done, compressed() wakes us up
+            if (oldest.compressing)
+                break;
+
+            expired.append(oldest.paths);
+            destination.totalBytes -= oldest.size;
+            destination.files.pop_front();
+        }
+    }
+
+    return expired;
+}
+
+}  // namespace QLogger
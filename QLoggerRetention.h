@@ -0,0 +1,169 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <deque>
+
+namespace QLogger
+{
+
+/**
+ * @brief The LogRetention struct is the policy that limits the rotated files of a destination. The limits are checked
+ * together and a value of 0 disables its limit.
+ */
+struct LogRetention
+{
+    /**
+    * @brief Days a rotated file is kept.
+    */
+    int maxDays = 0;
+    /**
+    * @brief Size of all the rotated files of the destination, compressed or not.
+    */
+    qint64 maxBytes = 0;
+    int maxFiles = 0;
+
+    bool isEnabled() const { return maxDays > 0 || maxBytes > 0 || maxFiles > 0; }
+};
+
+/**
+ * @brief The QLoggerRetention class deletes the rotated files of the destinations that have a LogRetention, from a
+ * thread of its own. The writers tell it about every file they rotate, so it keeps the list of files in order and
+ * applies the limits when a file is added or gets too old, without listing the folder again. The folder is only listed
+ * once, the first time a policy is set, to find the files rotated before.
+ */
+class QLoggerRetention : public QThread
+{
+public:
+    /**
+    * @brief Gets the instance shared by all the writers.
+    */
+    static QLoggerRetention *getInstance();
+
+    /**
+    * @brief setPolicy Sets the retention of a destination.
+    * @param destination The path of the file of the destination.
+    * @param retention The limits. A policy without limits stops tracking the destination.
+    */
+    void setPolicy(const QString &destination, const LogRetention &retention);
+
+    /**
+    * @brief track Adds a file rotated by a destination. It is ignored if the destination has no policy.
+    * @param destination The path of the file of the destination.
+    * @param paths The rotated file followed by the files its compression may create.
+    * @param compressing Whether the file is being compressed: it is not deleted until compressed is called.
+    */
+    void track(const QString &destination, const QStringList &paths, bool compressing);
+
+    /**
+    * @brief compressed Updates the size of a rotated file when its compression is done or was not done.
+    * @param path The rotated file.
+    */
+    void compressed(const QString &path);
+
+    /**
+    * @brief clearFolder Deletes the files of a folder older than some days, in the thread of the retention.
+    * @param folder The folder.
+    * @param days Minimum age of the files to delete, -1 to delete all of them.
+    * @param filters The name filters of the files.
+    */
+    void clearFolder(const QString &folder, int days, const QStringList &filters);
+
+protected:
+    void run() override;
+
+private:
+    struct RotatedFile
+    {
+        QStringList paths;
+        qint64 size      = 0;
+        qint64 time      = 0;
+        bool compressing = false;
+    };
+
+    struct Destination
+    {
+        LogRetention policy;
+        std::deque<RotatedFile> files;
+        qint64 totalBytes = 0;
+        bool listed       = false;
+    };
+
+    struct Sweep
+    {
+        QString folder;
+        int days = 0;
+        QStringList filters;
+    };
+
+    QMutex mMutex;
+    QWaitCondition mChanged;
+    QHash<QString, Destination> mDestinations;
+    QVector<Sweep> mSweeps;
+    bool mPending = false;
+    bool mStarted = false;
+    bool mQuit    = false;
+
+    QLoggerRetention();
+    ~QLoggerRetention() override;
+
+    /**
+    * @brief startThread Starts the thread with the first policy or folder to clear. mMutex must be locked.
+    */
+    void startThread();
+
+    /**
+    * @brief list Finds the files rotated by a destination before it was tracked, oldest first.
+    */
+    static std::deque<RotatedFile> list(const QString &destination);
+
+    /**
+    * @brief sweep Deletes the old files of a folder, as the former clearFileDestinationFolder did.
+    */
+    static void sweep(const Sweep &sweep);
+
+    /**
+    * @brief takeExpired Removes from the lists the files over the limits. mMutex must be locked.
+    * @param now The current time, in milliseconds since the epoch.
+    * @param next Receives the time the next file gets too old, 0 if none.
+    * @return The files to delete.
+    */
+    QStringList takeExpired(qint64 now, qint64 &next);
+
+    /**
+    * @brief findCompressing Finds a tracked file that is being compressed. mMutex must be locked.
+    * @param path The rotated file.
+    * @param destination If not null, receives the destination of the file.
+    */
+    RotatedFile *findCompressing(const QString &path, QString *destination = nullptr);
+};
+
+}  // namespace QLogger
@@ -0,0 +1,386 @@
+#include "QLoggerRing.h"
+
+#include "QLoggerClock.h"
+#include "QLoggerWriter.h"
+
+#include <QByteArray>
+
+#include <atomic>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#    include <io.h>
+#    include <windows.h>
+#else
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+const char RING_MAGIC[8]     = { 'Q', 'L', 'R', 'I', 'N', 'G', '0', '1' };
+const quint32 RECORD_MAGIC   = 0x52474C51;  // "QLGR"
+const qint64 RING_HEADER_SIZE = 4096;
+
+/**
+ * @brief The RingHeader struct is at the beginning of the file. The data starts after RING_HEADER_SIZE bytes.
+ */
+struct RingHeader
+{
+    char magic[8];
+    quint64 capacity;
+    /**
+    * @brief Number of bytes appended since the ring was created. The record at stream position p is at p % capacity.
+    */
+    quint64 head;
+};
+
+/**
+ * @brief The RecordHeader struct precedes the data of each record: the module and the message in UTF-16, then the
+ * function and the file in UTF-8. The size includes the padding to 8 bytes.
+ */
+struct RecordHeader
+{
+    quint32 magic;
+    quint32 size;
+    quint64 position;
+    qint64 msecsSinceEpoch;
+    quint64 threadId;
+    quint32 checksum;
+    qint32 line;
+    quint8 level;
+    quint8 formatted;
+    quint16 moduleLength;
+    quint16 functionLength;
+    quint16 fileLength;
+    quint32 messageLength;
+    quint32 reserved;
+};
+
+static_assert(sizeof(RecordHeader) % 8 == 0, "The records must be aligned to 8 bytes");
+
+quint64 align(quint64 size)
+{
+    return (size + 7) & ~quint64(7);
+}
+
+/**
+ * @brief Checksum of a record of aligned size, computed with its checksum field set to 0.
+ */
+quint32 checksum(const char *data, quint64 size)
+{
+    quint64 hash = 0xCBF29CE484222325ull;
+
+    for (quint64 i = 0; i < size; i += 8)
+    {
+        quint64 word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ull;
+    }
+
+    return static_cast<quint32>(hash ^ (hash >> 32));
+}
+
+/**
+ * @brief Buffer where each thread builds its records before copying them to the ring.
+ */
+QByteArray &recordBuffer()
+{
+    thread_local QByteArray buffer;
+
+    return buffer;
+}
+}  // namespace
+
+namespace QLogger
+{
+
+QLoggerRing::QLoggerRing(const QString &path, qint64 size)
+    : mFile(path)
+{
+    const auto capacity = align(static_cast<quint64>(qMax(size, qint64(64 * 1024))));
+    const auto fileSize = RING_HEADER_SIZE + static_cast<qint64>(capacity);
+
+    if (!mFile.open(QIODevice::ReadWrite))
+        return;
+
+    // An existing ring of the same size keeps the records of the previous runs
+    const auto reuse = mFile.size() == fileSize;
+
+    if (!reuse && !mFile.resize(fileSize))
+        return;
+
+    mMap = mFile.map(0, fileSize);
+
+    if (!mMap)
+        return;
+
+    auto header = reinterpret_cast<RingHeader *>(mMap);
+
+    if (!reuse || std::memcmp(header->magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 || header->capacity != capacity)
+    {
+        std::memset(mMap, 0, static_cast<size_t>(fileSize));
+        std::memcpy(header->magic, RING_MAGIC, sizeof(RING_MAGIC));
+        header->capacity = capacity;
+    }
+
+    mHead     = &header->head;
+    mCapacity = capacity;
+    mData     = reinterpret_cast<char *>(mMap + RING_HEADER_SIZE);
+    mSynced   = header->head;
+}
+
+QLoggerRing::~QLoggerRing()
+{
+    if (mMap)
+        mFile.unmap(mMap);
+}
+
+void QLoggerRing::append(const LogRecord &record)
+{
+    if (!record.module)
+    {
+        appendLine(record.message);
+        return;
+    }
+
+    // There is no writer thread to format the fields later, so they are stored as text
+    const auto message = record.fields.isEmpty() ? record.message
+                                                 : record.message + QLoggerWriter::formatFields(record.fields);
+
+    append(QLoggerClock::toMSecsSinceEpoch(record.timestamp), record.threadId, record.level, false, *record.module,
+           record.site->function, record.site->file, record.site->line, message);
+}
+
+void QLoggerRing::appendLine(const QString &line)
+{
+    append(QLoggerClock::currentMSecsSinceEpoch(), 0, LogLevel::Info, true, QStringView(), "", "", -1, line);
+}
+
+void QLoggerRing::append(qint64 msecsSinceEpoch, quintptr threadId, LogLevel level, bool formatted, QStringView module,
+                         const char *function, const char *file, int line, QStringView message)
+{
+    if (!mData)
+        return;
+
+    RecordHeader header {};
+    header.magic           = RECORD_MAGIC;
+    header.msecsSinceEpoch = msecsSinceEpoch;
+    header.threadId        = threadId;
+    header.line            = line;
+    header.level           = static_cast<quint8>(level);
+    header.formatted       = formatted ? 1 : 0;
+    header.moduleLength    = static_cast<quint16>(qMin<qsizetype>(module.size(), 0xFFFF));
+    header.functionLength  = static_cast<quint16>(qMin<size_t>(std::strlen(function), 0xFFFF));
+    header.fileLength      = static_cast<quint16>(qMin<size_t>(std::strlen(file), 0xFFFF));
+
+    // A record can't take more than a quarter of the ring
+    const auto fixedSize  = sizeof(RecordHeader) + 2 * header.moduleLength + header.functionLength + header.fileLength;
+    const auto maxMessage = (mCapacity / 4 - qMin<quint64>(fixedSize, mCapacity / 4)) / 2;
+
+    header.messageLength = static_cast<quint32>(qMin<quint64>(static_cast<quint64>(message.size()), maxMessage));
+
+    const auto size = align(fixedSize + 2 * header.messageLength);
+
+    if (size > mCapacity / 4)
+        return;
+
+    header.size = static_cast<quint32>(size);
+
+    auto &buffer = recordBuffer();
+    buffer.resize(static_cast<qsizetype>(size));
+
+    auto data = buffer.data();
+    std::memset(data + size - 8, 0, 8);
+
+    auto next = data + sizeof(RecordHeader);
+    std::memcpy(next, module.data(), 2 * header.moduleLength);
+    next += 2 * header.moduleLength;
+    std::memcpy(next, message.data(), 2 * header.messageLength);
+    next += 2 * header.messageLength;
+    std::memcpy(next, function, header.functionLength);
+    next += header.functionLength;
+    std::memcpy(next, file, header.fileLength);
+
+    // Counted from before the bytes are reserved until they are copied, see sync
+    mAppending.fetch_add(1);
+
+    header.position = std::atomic_ref<quint64>(*mHead).fetch_add(size);
+
+    std::memcpy(data, &header, sizeof(RecordHeader));
+
+    header.checksum = checksum(data, size);
+    std::memcpy(data, &header, sizeof(RecordHeader));
+
+    copy(header.position, data, size);
+
+    mAppending.fetch_sub(1, std::memory_order_release);
+}
+
+void QLoggerRing::sync()
+{
+    if (!mMap)
+        return;
+
+    QMutexLocker locker(&mSyncMutex);
+
+    // A producer that reserved its bytes before the head is read is still counted: if none is, every record below
+    // the head is complete and the next sync can start there
+    const auto head     = std::atomic_ref<quint64>(*mHead).load();
+    const auto complete = mAppending.load() == 0;
+    const auto from     = qMax(mSynced, head > mCapacity ? head - mCapacity : 0);
+
+    // The header holds the head
+    syncRange(0, sizeof(RingHeader));
+
+    if (from < head)
+    {
+        const auto start = from % mCapacity;
+        const auto end   = start + (head - from);
+
+        syncRange(RING_HEADER_SIZE + start, qMin(end, mCapacity) - start);
+
+        // The range wraps around the end of the ring
+        if (end > mCapacity)
+            syncRange(RING_HEADER_SIZE, end - mCapacity);
+    }
+
+    if (complete)
+        mSynced = head;
+
+#if defined(Q_OS_WIN)
+    FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(mFile.handle())));
+#endif
+}
+
+void QLoggerRing::syncRange(quint64 offset, quint64 size)
+{
+#if defined(Q_OS_WIN)
+    FlushViewOfFile(mMap + offset, static_cast<SIZE_T>(size));
+#else
+    // msync needs an address aligned to a page, the mapping starts at one
+    static const auto pageSize = static_cast<quint64>(sysconf(_SC_PAGESIZE));
+
+    const auto start = offset - offset % pageSize;
+
+    msync(mMap + start, static_cast<size_t>(offset + size - start), MS_SYNC);
+#endif
+}
+
+void QLoggerRing::copy(quint64 offset, const char *data, quint64 size)
+{
+    const auto start = offset % mCapacity;
+    const auto first = qMin(size, mCapacity - start);
+
+    std::memcpy(mData + start, data, first);
+
+    if (first < size)
+        std::memcpy(mData, data + first, size - first);
+}
+
+QVector<LogEntry> QLoggerRing::read(const QString &path, QString *error)
+{
+    QVector<LogEntry> entries;
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (error)
+            *error = file.errorString();
+
+        return entries;
+    }
+
+    const auto content = file.readAll();
+
+    RingHeader header {};
+
+    if (content.size() > RING_HEADER_SIZE)
+        std::memcpy(&header, content.constData(), sizeof(RingHeader));
+
+    if (content.size() <= RING_HEADER_SIZE || std::memcmp(header.magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0
+        || content.size() != RING_HEADER_SIZE + static_cast<qint64>(header.capacity))
+    {
+        if (error)
+            *error = QStringLiteral("%1 is not a ring file").arg(path);
+
+        return entries;
+    }
+
+    const auto data     = content.constData() + RING_HEADER_SIZE;
+    const auto capacity = header.capacity;
+    const auto head     = header.head;
+
+    // Gets the bytes at a stream position, joining the end and the beginning of the ring
+    QByteArray bytes;
+    const auto at = [&](quint64 position, quint64 size) {
+        bytes.resize(static_cast<qsizetype>(size));
+
+        const auto start = position % capacity;
+        const auto first = qMin(size, capacity - start);
+
+        std::memcpy(bytes.data(), data + start, first);
+        std::memcpy(bytes.data() + first, data, size - first);
+
+        return bytes.data();
+    };
+
+    // The oldest records are overwritten: look for the first valid one, 8 bytes at a time
+    auto position = head > capacity ? head - capacity : 0;
+
+    while (position + sizeof(RecordHeader) <= head)
+    {
+        RecordHeader record;
+        std::memcpy(&record, at(position, sizeof(RecordHeader)), sizeof(RecordHeader));
+
+        const auto valid = record.magic == RECORD_MAGIC && record.position == position
+            && record.size >= sizeof(RecordHeader) && record.size % 8 == 0 && record.size <= capacity
+            && position + record.size <= head;
+
+        if (!valid)
+        {
+            position += 8;
+            continue;
+        }
+
+        const auto expected = record.checksum;
+        const auto recordData = at(position, record.size);
+
+        record.checksum = 0;
+        std::memcpy(recordData, &record, sizeof(RecordHeader));
+
+        const auto payloadSize = sizeof(RecordHeader) + 2 * (record.moduleLength + quint64(record.messageLength))
+            + record.functionLength + record.fileLength;
+
+        if (payloadSize > record.size || checksum(recordData, record.size) != expected)
+        {
+            position += 8;
+            continue;
+        }
+
+        LogEntry entry;
+        entry.msecsSinceEpoch = record.msecsSinceEpoch;
+        entry.threadId        = QString("%1").arg(record.threadId, QT_POINTER_SIZE * 2, 16, QChar('0'));
+        entry.level           = static_cast<LogLevel>(record.level);
+        entry.formatted       = record.formatted != 0;
+        entry.line            = record.line;
+
+        auto next     = recordData + sizeof(RecordHeader);
+        entry.module  = QString(reinterpret_cast<const QChar *>(next), record.moduleLength);
+        next += 2 * record.moduleLength;
+        entry.message = QString(reinterpret_cast<const QChar *>(next), record.messageLength);
+        next += 2 * record.messageLength;
+        entry.function = QString::fromUtf8(next, record.functionLength);
+        next += record.functionLength;
+        entry.file = QString::fromUtf8(next, record.fileLength);
+
+        entries.append(entry);
+
+        position += record.size;
+    }
+
+    return entries;
+}
+
+}  // namespace QLogger
@@ -0,0 +1,111 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QFile>
+#include <QLoggerRecord.h>
+#include <QMutex>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#include <atomic>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerRing class stores the records in a file of fixed size that is mapped in memory and used as a ring
+ * buffer. Appending a record only copies it in the mapped pages: there is no queue and no system call, and the
+ * kernel keeps the data of the file even if the process is killed. A power loss can lose the pages not written to the
+ * disk yet: sync writes them, as QLoggerWriter::flush and the messages at the flush level do. The records are
+ * decoded afterwards by QLoggerDecoder.
+ *
+ * The file starts with a header of one page that holds the total number of bytes appended. Each record is aligned to
+ * 8 bytes and carries a magic number, its position in the stream and a checksum, so that the reader can skip the
+ * records that were overwritten or not completely written.
+ */
+class QLoggerRing
+{
+public:
+    /**
+    * @brief Constructor that maps the file. An existing ring of the same size is continued, otherwise the file is
+    * created or resized.
+    * @param path The path of the ring file.
+    * @param size The size of the ring in bytes.
+    */
+    QLoggerRing(const QString &path, qint64 size);
+    ~QLoggerRing();
+
+    QLoggerRing(const QLoggerRing &) = delete;
+    QLoggerRing &operator=(const QLoggerRing &) = delete;
+
+    /**
+    * @brief isOpen Whether the file could be mapped.
+    */
+    bool isOpen() const { return mData != nullptr; }
+
+    /**
+    * @brief append Copies a record in the ring. It can be called from any thread.
+    */
+    void append(const LogRecord &record);
+
+    /**
+    * @brief appendLine Copies an already formatted line in the ring.
+    */
+    void appendLine(const QString &line);
+
+    /**
+    * @brief sync Writes to the disk the pages of the records appended since the previous sync, and the header, and
+    * waits for them. When another thread was still copying a record the range is kept, so the next sync writes it
+    * again.
+    */
+    void sync();
+
+    /**
+    * @brief read Reads the valid records of a ring file, from the oldest to the newest.
+    * @param path The path of the ring file.
+    * @param error If not null, receives the reason why the file can't be read.
+    */
+    static QVector<LogEntry> read(const QString &path, QString *error = nullptr);
+
+private:
+    QFile mFile;
+    uchar *mMap       = nullptr;
+    char *mData       = nullptr;
+    quint64 *mHead    = nullptr;
+    quint64 mCapacity = 0;
+    /**
+    * @brief Stream position up to which the records are on the disk, and the number of producers copying a record.
+    */
+    quint64 mSynced = 0;
+    std::atomic<int> mAppending { 0 };
+    QMutex mSyncMutex;
+
+    void append(qint64 msecsSinceEpoch, quintptr threadId, LogLevel level, bool formatted, QStringView module,
+                const char *function, const char *file, int line, QStringView message);
+    void copy(quint64 offset, const char *data, quint64 size);
+    void syncRange(quint64 offset, quint64 size);
+};
+
+}  // namespace QLogger
@@ -0,0 +1,52 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QLoggerRecord.h>
+#include <QVector>
+
+namespace QLogger
+{
+
+class QLoggerWriter;
+
+/**
+ * @brief The QLoggerSink class is an output added to a destination next to its file and console. Every batch written
+ * by the destination is given to its sinks from the writer thread, so a sink must not block: a slow output has to keep
+ * its own queue, as QLoggerNetworkSink does.
+ */
+class QLoggerSink
+{
+public:
+    virtual ~QLoggerSink() = default;
+
+    /**
+    * @brief write Writes a batch of records. It is called by the writer thread of each destination the sink is added
+    * to, so a sink added to several destinations is called from several threads.
+    * @param writer The destination of the batch. Its formatRecord builds the lines with the destination options.
+    * @param records The records of the batch. Those with a null module are already formatted lines.
+    */
+    virtual void write(QLoggerWriter &writer, const QVector<LogRecord> &records) = 0;
+};
+
+}  // namespace QLogger
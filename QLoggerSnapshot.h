@@ -0,0 +1,142 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerSnapshot class publishes an immutable value that is read without locking. Every change publishes a
+ * new copy and the replaced copies are deleted once no reader is left. The readers are counted in a few counters of
+ * their own cache line, one per group of threads, so the threads that log don't write to the same cache line.
+ */
+template<typename T>
+class QLoggerSnapshot
+{
+    static constexpr int STRIPES = 16;
+
+public:
+    /**
+    * @brief The Reader class keeps the value that was published when it was created until it is destroyed.
+    */
+    class Reader
+    {
+    public:
+        explicit Reader(const QLoggerSnapshot &snapshot)
+            : mReaders(snapshot.mReaders[stripe()].count)
+        {
+            // Counted before the load: either reclaim sees the reader or the reader loads the new value
+            mReaders.fetch_add(1);
+            mValue = snapshot.mValue.load();
+        }
+
+        ~Reader() { mReaders.fetch_sub(1, std::memory_order_release); }
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        const T *get() const { return mValue; }
+        const T *operator->() const { return mValue; }
+        const T &operator*() const { return *mValue; }
+        explicit operator bool() const { return mValue != nullptr; }
+
+    private:
+        std::atomic<int> &mReaders;
+        const T *mValue = nullptr;
+    };
+
+    QLoggerSnapshot() = default;
+
+    QLoggerSnapshot(const QLoggerSnapshot &) = delete;
+    QLoggerSnapshot &operator=(const QLoggerSnapshot &) = delete;
+
+    /**
+    * @brief read Gets the current value, null if none was published.
+    */
+    Reader read() const { return Reader(*this); }
+
+    /**
+    * @brief publish Replaces the value and deletes the replaced ones if no reader is left. The calls to publish and
+    * reclaim must be serialized by the caller.
+    */
+    void publish(std::unique_ptr<const T> value)
+    {
+        mValue.store(value.get());
+        mPublished.push_back(std::move(value));
+        mRetired.store(mPublished.size() > 1, std::memory_order_relaxed);
+
+        reclaim();
+    }
+
+    /**
+    * @brief reclaim Deletes the replaced values if no reader is left.
+    */
+    void reclaim()
+    {
+        if (mPublished.size() < 2)
+            return;
+
+        for (const auto &readers : mReaders)
+        {
+            if (readers.count.load() != 0)
+                return;
+        }
+
+        mPublished.erase(mPublished.begin(), mPublished.end() - 1);
+        mRetired.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+    * @brief hasRetired Whether replaced values are waiting for their readers, so reclaim has something to delete.
+    */
+    bool hasRetired() const { return mRetired.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Readers
+    {
+        std::atomic<int> count { 0 };
+    };
+
+    std::atomic<const T *> mValue { nullptr };
+    mutable std::array<Readers, STRIPES> mReaders {};
+    std::vector<std::unique_ptr<const T>> mPublished;
+    std::atomic<bool> mRetired { false };
+
+    /**
+    * @brief stripe Gets the counter of the current thread. The threads take the counters in turn.
+    */
+    static int stripe()
+    {
+        static std::atomic<int> next { 0 };
+        thread_local const auto stripe = next.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+
+        return stripe;
+    }
+};
+
+}  // namespace QLogger
@@ -0,0 +1,183 @@
+#include "QLoggerStats.h"
+
+namespace
+{
+/**
+ * @brief Escapes a label value of the Prometheus text format.
+ */
+QString labelValue(QString value)
+{
+    return value.replace(QLatin1Char('\\'), QStringLiteral("\\\\"))
+        .replace(QLatin1Char('"'), QStringLiteral("\\\""))
+        .replace(QLatin1Char('\n'), QStringLiteral("\\n"));
+}
+
+void appendMetric(QString &out, const QString &name, const QString &type, const QString &help)
+{
+    out.append(QString("# HELP %1 %2\n# TYPE %1 %3\n").arg(name, help, type));
+}
+
+QString labelSet(const QString &labels)
+{
+    return labels.isEmpty() ? QString() : QString("{%1}").arg(labels);
+}
+
+void appendValue(QString &out, const QString &name, const QString &labels, quint64 value)
+{
+    out.append(QString("%1%2 %3\n").arg(name, labelSet(labels), QString::number(value)));
+}
+
+/**
+ * @brief Appends the cumulative buckets, the sum and the count of a histogram.
+ * @param scale The factor that converts the values of the histogram to the unit of the metric.
+ */
+void appendHistogram(QString &out, const QString &name, const QString &labels, const QLogger::LogHistogram &histogram,
+                     double scale)
+{
+    const auto separator = labels.isEmpty() ? QString() : QStringLiteral(",");
+    quint64 cumulative   = 0;
+
+    // The buckets hold the values of their range only: each le bucket gets the sum of the buckets up to it. The last
+    // one also holds the larger values, so it is only counted by +Inf
+    for (auto i = 0; i < QLogger::LogHistogram::BUCKETS - 1; ++i)
+    {
+        cumulative += histogram.buckets[i];
+
+        out.append(QString("%1_bucket{%2%3le=\"%4\"} %5\n")
+                       .arg(name, labels, separator,
+                            QString::number(QLogger::LogHistogram::maxValue(i) * scale, 'g', 12),
+                            QString::number(cumulative)));
+    }
+
+    out.append(QString("%1_bucket{%2%3le=\"+Inf\"} %4\n").arg(name, labels, separator, QString::number(histogram.count)));
+    out.append(QString("%1_sum%2 %3\n").arg(name, labelSet(labels), QString::number(histogram.sum * scale, 'g', 12)));
+    appendValue(out, name + QStringLiteral("_count"), labels, histogram.count);
+}
+}  // namespace
+
+namespace QLogger
+{
+
+quint64 LogHistogram::percentile(double percent) const
+{
+    if (count == 0)
+        return 0;
+
+    const auto rank = static_cast<quint64>(count * qBound(0.0, percent, 100.0) / 100.0);
+    quint64 cumulative = 0;
+
+    for (auto i = 0; i < BUCKETS; ++i)
+    {
+        cumulative += buckets[i];
+
+        if (cumulative > rank || cumulative == count)
+            return upperBound(i);
+    }
+
+    return upperBound(BUCKETS - 1);
+}
+
+LogHistogram QLoggerHistogram::values() const
+{
+    LogHistogram histogram;
+
+    for (auto i = 0; i < LogHistogram::BUCKETS; ++i)
+    {
+        histogram.buckets[i] = mBuckets[i].load(std::memory_order_relaxed);
+        histogram.count += histogram.buckets[i];
+    }
+
+    histogram.sum = mSum.load(std::memory_order_relaxed);
+
+    return histogram;
+}
+
+QStringList LogStats::toText() const
+{
+    QStringList lines;
+
+    for (const auto &writer : writers)
+    {
+        lines.append(QString("file=%1 enqueued=%2 written=%3 dropped=%4 bytes=%5 batches=%6 queue=%7 queue_max=%8 "
+                             "batch_p50=%9 write_p99_us=%10 sync_p99_us=%11 enqueue_p99_us=%12")
+                         .arg(writer.fileDestination, QString::number(writer.enqueued), QString::number(writer.written),
+                              QString::number(writer.dropped), QString::number(writer.bytesWritten),
+                              QString::number(writer.batches), QString::number(writer.queueDepth),
+                              QString::number(writer.queueHighWater), QString::number(writer.batchSize.percentile(50)))
+                         .arg(writer.writeLatency.percentile(99))
+                         .arg(writer.syncLatency.percentile(99))
+                         .arg(writer.enqueueLatency.percentile(99)));
+    }
+
+    lines.append(QString("compression compressed=%1 failed=%2 skipped=%3 pending=%4 time_p99_ms=%5")
+                     .arg(compression.compressed)
+                     .arg(compression.failed)
+                     .arg(compression.skipped)
+                     .arg(compression.pending)
+                     .arg(compression.time.percentile(99)));
+
+    return lines;
+}
+
+QString LogStats::toPrometheus() const
+{
+    QString out;
+
+    const auto counter = [&](const QString &name, const QString &help, quint64 LogWriterStats::*value) {
+        appendMetric(out, name, QStringLiteral("counter"), help);
+
+        for (const auto &writer : writers)
+            appendValue(out, name, QString("file=\"%1\"").arg(labelValue(writer.fileDestination)), writer.*value);
+    };
+
+    counter(QStringLiteral("qlogger_messages_enqueued_total"), QStringLiteral("Messages enqueued."), &LogWriterStats::enqueued);
+    counter(QStringLiteral("qlogger_messages_written_total"), QStringLiteral("Messages written."), &LogWriterStats::written);
+    counter(QStringLiteral("qlogger_messages_dropped_total"), QStringLiteral("Messages discarded by the overflow policy."),
+            &LogWriterStats::dropped);
+    counter(QStringLiteral("qlogger_written_bytes_total"), QStringLiteral("Bytes written to the file."),
+            &LogWriterStats::bytesWritten);
+    counter(QStringLiteral("qlogger_batches_total"), QStringLiteral("Batches written."), &LogWriterStats::batches);
+
+    const auto gauge = [&](const QString &name, const QString &help, qint64 LogWriterStats::*value) {
+        appendMetric(out, name, QStringLiteral("gauge"), help);
+
+        for (const auto &writer : writers)
+            appendValue(out, name, QString("file=\"%1\"").arg(labelValue(writer.fileDestination)), writer.*value);
+    };
+
+    gauge(QStringLiteral("qlogger_queue_depth"), QStringLiteral("Messages waiting in the queue."), &LogWriterStats::queueDepth);
+    gauge(QStringLiteral("qlogger_queue_high_water"), QStringLiteral("Largest number of messages taken from the queue at once."),
+          &LogWriterStats::queueHighWater);
+
+    const auto histogram = [&](const QString &name, const QString &help, LogHistogram LogWriterStats::*value, double scale) {
+        appendMetric(out, name, QStringLiteral("histogram"), help);
+
+        for (const auto &writer : writers)
+            appendHistogram(out, name, QString("file=\"%1\"").arg(labelValue(writer.fileDestination)), writer.*value, scale);
+    };
+
+    histogram(QStringLiteral("qlogger_batch_messages"), QStringLiteral("Messages per batch."), &LogWriterStats::batchSize, 1);
+    histogram(QStringLiteral("qlogger_write_seconds"), QStringLiteral("Time to write a batch."),
+              &LogWriterStats::writeLatency, 1e-6);
+    histogram(QStringLiteral("qlogger_sync_seconds"), QStringLiteral("Time to sync the file to the disk."),
+              &LogWriterStats::syncLatency, 1e-6);
+    histogram(QStringLiteral("qlogger_enqueue_seconds"), QStringLiteral("Time to enqueue a message, sampled."),
+              &LogWriterStats::enqueueLatency, 1e-6);
+
+    appendMetric(out, QStringLiteral("qlogger_compressed_files_total"), QStringLiteral("counter"),
+                 QStringLiteral("Rotated files compressed."));
+    appendValue(out, QStringLiteral("qlogger_compressed_files_total"), QString(), compression.compressed);
+    appendMetric(out, QStringLiteral("qlogger_compression_failures_total"), QStringLiteral("counter"),
+                 QStringLiteral("Rotated files that couldn't be compressed."));
+    appendValue(out, QStringLiteral("qlogger_compression_failures_total"), QString(), compression.failed);
+    appendMetric(out, QStringLiteral("qlogger_compression_skipped_total"), QStringLiteral("counter"),
+                 QStringLiteral("Rotated files left uncompressed because too many were pending."));
+    appendValue(out, QStringLiteral("qlogger_compression_skipped_total"), QString(), compression.skipped);
+    appendMetric(out, QStringLiteral("qlogger_compression_seconds"), QStringLiteral("histogram"),
+                 QStringLiteral("Time to compress a rotated file."));
+    appendHistogram(out, QStringLiteral("qlogger_compression_seconds"), QString(), compression.time, 1e-3);
+
+    return out;
+}
+
+}  // namespace QLogger
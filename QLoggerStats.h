@@ -0,0 +1,163 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+
+namespace QLogger
+{
+
+/**
+ * @brief The LogHistogram struct is a copy of the values of a QLoggerHistogram.
+ */
+struct LogHistogram
+{
+    static constexpr int BUCKETS = 32;
+
+    /**
+    * @brief Number of values per bucket: the bucket i holds the values below 2^i and at least 2^(i-1).
+    */
+    std::array<quint64, BUCKETS> buckets {};
+    quint64 count = 0;
+    quint64 sum   = 0;
+
+    /**
+    * @brief upperBound Gets the value that bounds the bucket.
+    */
+    static quint64 upperBound(int bucket) { return quint64(1) << bucket; }
+
+    /**
+    * @brief maxValue Gets the largest value of the bucket, the inclusive bound of a Prometheus bucket.
+    */
+    static quint64 maxValue(int bucket) { return upperBound(bucket) - 1; }
+
+    /**
+    * @brief percentile Gets the upper bound of the bucket of a percentile, 0 if there are no values.
+    * @param percent The percentile, from 0 to 100.
+    */
+    quint64 percentile(double percent) const;
+};
+
+/**
+ * @brief The QLoggerHistogram class counts values in buckets of powers of two. Recording a value is two relaxed atomic
+ * additions, so it can be done from any thread.
+ */
+class QLoggerHistogram
+{
+public:
+    void record(quint64 value)
+    {
+        const auto bucket = std::min<int>(std::bit_width(value), LogHistogram::BUCKETS - 1);
+
+        mBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        mSum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+    * @brief values Gets a copy of the values. It is approximate while other threads record values.
+    */
+    LogHistogram values() const;
+
+private:
+    std::array<std::atomic<quint64>, LogHistogram::BUCKETS> mBuckets {};
+    std::atomic<quint64> mSum { 0 };
+};
+
+/**
+ * @brief The LogWriterStats struct holds the counters of a destination since it was created.
+ */
+struct LogWriterStats
+{
+    QString fileDestination;
+    quint64 enqueued     = 0;
+    quint64 written      = 0;
+    quint64 dropped      = 0;
+    quint64 bytesWritten = 0;
+    quint64 batches      = 0;
+    qint64 queueDepth    = 0;
+    /**
+    * @brief Largest number of messages taken from the queue at once.
+    */
+    qint64 queueHighWater = 0;
+    /**
+    * @brief Messages per batch.
+    */
+    LogHistogram batchSize;
+    /**
+    * @brief Microseconds to write a batch, to sync the file and to enqueue a message. The enqueue latency is sampled
+    * once every 256 messages of each thread.
+    */
+    LogHistogram writeLatency;
+    LogHistogram syncLatency;
+    LogHistogram enqueueLatency;
+};
+
+/**
+ * @brief The LogCompressionStats struct holds the counters of QLoggerCompressor.
+ */
+struct LogCompressionStats
+{
+    quint64 compressed = 0;
+    quint64 failed     = 0;
+    /**
+    * @brief Files left uncompressed because too many were pending.
+    */
+    quint64 skipped = 0;
+    int pending     = 0;
+    /**
+    * @brief Milliseconds to compress a file.
+    */
+    LogHistogram time;
+    /**
+    * @brief Description of the last compression.
+    */
+    QString lastResult;
+};
+
+/**
+ * @brief The LogStats struct is what QLoggerManager::stats returns.
+ */
+struct LogStats
+{
+    QVector<LogWriterStats> writers;
+    LogCompressionStats compression;
+
+    /**
+    * @brief toText Formats the stats as log lines, one per destination and one for the compression.
+    */
+    QStringList toText() const;
+
+    /**
+    * @brief toPrometheus Formats the stats in the Prometheus text exposition format.
+    */
+    QString toPrometheus() const;
+};
+
+}  // namespace QLogger
@@ -0,0 +1,88 @@
+#include "QLoggerThread.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+
+#include <atomic>
+
+namespace
+{
+QMutex namesMutex;
+QHash<quintptr, QString> names;
+std::atomic<int> namesGeneration { 0 };
+
+void setName(quintptr id, const QString &name)
+{
+    {
+        QMutexLocker lock(&namesMutex);
+
+        if (name.isEmpty())
+            names.remove(id);
+        else
+            names.insert(id, name);
+    }
+
+    namesGeneration.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief The ThreadState struct is the thread-local cache of the identifier. It removes the name of the thread when
+ * the thread finishes, so a new thread reusing the identifier doesn't inherit it.
+ */
+struct ThreadState
+{
+    quintptr id = reinterpret_cast<quintptr>(QThread::currentThread());
+    bool named  = false;
+
+    ~ThreadState()
+    {
+        if (named)
+            setName(id, QString());
+    }
+};
+
+ThreadState &threadState()
+{
+    thread_local ThreadState state;
+
+    return state;
+}
+}  // namespace
+
+namespace QLogger
+{
+
+quintptr QLoggerThread::currentId()
+{
+    return threadState().id;
+}
+
+void QLoggerThread::setCurrentName(const QString &name)
+{
+    auto &state = threadState();
+
+    setName(state.id, name);
+    state.named = !name.isEmpty();
+}
+
+QString QLoggerThread::displayName(quintptr id)
+{
+    {
+        QMutexLocker lock(&namesMutex);
+
+        const auto name = names.value(id);
+
+        if (!name.isEmpty())
+            return name;
+    }
+
+    return QString("%1").arg(id, QT_POINTER_SIZE * 2, 16, QChar('0'));
+}
+
+int QLoggerThread::generation()
+{
+    return namesGeneration.load(std::memory_order_acquire);
+}
+
+}  // namespace QLogger
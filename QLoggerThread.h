@@ -0,0 +1,63 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QString>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerThread class identifies the threads that log. The identifier of a thread is looked up once and
+ * kept in thread-local storage, and only that integer travels with the records. The text displayed in the log lines
+ * is built by the writers, which cache it per thread.
+ */
+class QLoggerThread
+{
+public:
+    /**
+    * @brief currentId Gets the identifier of the current thread.
+    */
+    static quintptr currentId();
+
+    /**
+    * @brief setCurrentName Sets the name displayed instead of the identifier of the current thread. The name is
+    * forgotten when the thread finishes.
+    * @param name The name of the thread. An empty name displays the identifier again.
+    */
+    static void setCurrentName(const QString &name);
+
+    /**
+    * @brief displayName Gets the text displayed for a thread: its name if it has one, otherwise its identifier in
+    * hexadecimal.
+    * @param id The identifier of the thread.
+    */
+    static QString displayName(quintptr id);
+
+    /**
+    * @brief generation Gets a counter that changes whenever a thread name changes, so the cached texts can be dropped.
+    */
+    static int generation();
+};
+
+}  // namespace QLogger
@@ -0,0 +1,17 @@
+QT -= gui
+QT += testlib
+
+CONFIG += c++20 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_qlogger
+
+SOURCES += \
+        minlevel.cpp \
+        tst_qlogger.cpp
+
+
+!build_pass:message("QLoggerUnitTest: importing QLogger")
+if( !include($$PWD/../QLogger.pri) ) {
+    error( Could not find the QLogger.pri file. )
+}
@@ -0,0 +1,34 @@
+/**
+ * @file minlevel.cpp
+ *
+ * @brief Logs at every level with QLOGGER_MIN_LEVEL set to Warning, as a project built with
+ * qmake QLOGGER_MIN_LEVEL=3 does, for tst_QLogger::compileTimeLevel.
+ *
+ * @module QLoggerUnitTest
+ */
+#define QLOGGER_MIN_LEVEL 3
+
+#include "QLogger.h"
+
+static_assert(!QLogger::isCompiledLevel(QLogger::LogLevel::Info)
+                  && QLogger::isCompiledLevel(QLogger::LogLevel::Warning),
+              "The levels below QLOGGER_MIN_LEVEL are not built");
+
+int logAtEveryLevel(const QString &module)
+{
+    auto evaluated = 0;
+
+    const auto message = [&evaluated](const char *text) {
+        ++evaluated;
+        return QString::fromLatin1(text);
+    };
+
+    QLog_Trace(module, message("Trace"));
+    QLog_Debug(module, message("Debug"));
+    QLog_Info(module, message("Info"));
+    QLog_Warning(module, message("Warning"));
+    QLog_Error(module, message("Error"));
+    QLog_Fatal(module, message("Fatal"));
+
+    return evaluated;
+}
@@ -0,0 +1,1714 @@
+/**
+ * @file tst_qlogger.cpp
+ *
+ * @brief Unit tests of QLogger: the messages logged, also by several threads at the same time, are read back from
+ * the files and compared with what was logged.
+ *
+ * @module QLoggerUnitTest
+ */
+#include "QLogger.h"
+#include "QLoggerBinary.h"
+#include "QLoggerClock.h"
+#include "QLoggerCompressor.h"
+#include "QLoggerConfig.h"
+#include "QLoggerConsole.h"
+#include "QLoggerNetworkSink.h"
+#include "QLoggerQueue.h"
+#include "QLoggerRetention.h"
+#include "QLoggerRing.h"
+#include "QLoggerSnapshot.h"
+#include "QLoggerStats.h"
+#include "QLoggerThread.h"
+#include "QLoggerUtf8.h"
+#include "QLoggerWriter.h"
+
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QUdpSocket>
+#include <QtTest>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace QLogger;
+
+/**
+ * @brief Logs a message at each level in the module, in a file built with QLOGGER_MIN_LEVEL=3 (minlevel.cpp).
+ * @return The number of messages evaluated.
+ */
+int logAtEveryLevel(const QString &module);
+
+namespace
+{
+/**
+ * @brief Reads the lines of a text file, without the empty ones.
+ */
+QStringList readLines(const QString &path)
+{
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return QStringList();
+
+    return QString::fromUtf8(file.readAll()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+}
+
+/**
+ * @brief Replaces the content of a file.
+ */
+void writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        file.write(data);
+}
+
+/**
+ * @brief Uncompresses a gzip file of a single member, as QLoggerCompressor::gzip writes the files smaller than its
+ * chunk. The raw deflate stream of the member is given to qUncompress with the zlib header and the Adler-32 checksum
+ * of the expected data.
+ */
+QByteArray gunzip(const QByteArray &gzip, const QByteArray &expected)
+{
+    quint32 a = 1;
+    quint32 b = 0;
+
+    for (const auto byte : expected)
+    {
+        a = (a + static_cast<quint8>(byte)) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    const auto appendBigEndian = [](QByteArray &data, quint32 value) {
+        for (const auto shift : { 24, 16, 8, 0 })
+            data.append(static_cast<char>((value >> shift) & 0xFF));
+    };
+
+    QByteArray zlib;
+    appendBigEndian(zlib, static_cast<quint32>(expected.size()));
+    zlib.append("\x78\x9c", 2);
+    zlib.append(gzip.mid(10, gzip.size() - 18));
+    appendBigEndian(zlib, (b << 16) | a);
+
+    return qUncompress(zlib);
+}
+
+/**
+ * @brief Builds a record of the current thread, as QLoggerManager does for the QLog_* macros.
+ */
+LogRecord makeRecord(const QString *module, LogLevel level, const QString &message)
+{
+    LogRecord record;
+    record.timestamp = QLoggerClock::now();
+    record.threadId  = QLoggerThread::currentId();
+    record.level     = level;
+    record.module    = module;
+    record.message   = message;
+
+    return record;
+}
+
+/**
+ * @brief Gets the files rotated by a destination with LogFileDisplay::Number, oldest first.
+ */
+QStringList rotatedFiles(const QString &folder, const QString &name)
+{
+    QStringList files;
+
+    for (auto number = 2; number < 100; ++number)
+    {
+        const auto path = QDir(folder).filePath(QString("%1(%2).log").arg(name).arg(number));
+
+        if (QFile::exists(path))
+            files.append(path);
+    }
+
+    return files;
+}
+
+/**
+ * @brief Counts the lines that are not "<thread> <index>" with the indexes of each thread in order, from 0.
+ * @param lines The lines to check.
+ * @param threadCount The number of threads that logged the lines.
+ * @param next Gets the number of lines of each thread.
+ */
+int unorderedLines(const QStringList &lines, int threadCount, std::vector<int> &next)
+{
+    auto unexpected = 0;
+    next.assign(threadCount, 0);
+
+    for (const auto &line : lines)
+    {
+        const auto parts = line.split(QLatin1Char(' '));
+        const auto t     = parts.constFirst().toInt();
+
+        if (parts.size() != 2 || t < 0 || t >= threadCount || parts.constLast().toInt() != next[t])
+            ++unexpected;
+        else
+            ++next[t];
+    }
+
+    return unexpected;
+}
+}  // namespace
+
+class tst_QLogger : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void queue();
+    void concurrentEnqueue();
+    void concurrentLogging();
+    void messagesBeforeDestination();
+    void levelCheckBeforeMessage();
+    void compileTimeLevel();
+    void formatOnWriterThread();
+    void clock();
+    void threadId();
+    void appendToFile();
+    void sharedWriter();
+    void overflowPolicy_data();
+    void overflowPolicy();
+    void blockingQueue();
+    void gzipCompression();
+    void sizeRotation();
+    void dateRotation();
+    void flushPolicy();
+    void writeThrough();
+    void memoryMappedRing();
+    void binaryFormat();
+    void structuredFields();
+    void preRegistrationLimit();
+    void moduleHandle();
+    void callSite();
+    void consoleLines();
+    void udpSink();
+    void writerPool();
+    void rateLimit();
+    void stats();
+    void closeInParallel();
+    void snapshotReclaim();
+    void configReload();
+    void retention();
+    void reusedBuffers();
+    void utf8();
+
+private:
+    QTemporaryDir mFolder;
+
+    /**
+    * @brief The path of a file in the folder of the test.
+    */
+    QString filePath(const QString &fileName) const { return QDir(mFolder.path()).filePath(fileName); }
+};
+
+void tst_QLogger::initTestCase()
+{
+    QVERIFY(mFolder.isValid());
+
+    // The modules without destination keep the messages that pass the default level
+    QLoggerManager::getInstance()->setDefaultLevel(LogLevel::Info);
+}
+
+/**
+ * @brief Several producers and consumers share a small queue: every value comes out once and the values of each
+ * producer come out in the order they were pushed.
+ */
+void tst_QLogger::queue()
+{
+    const auto producers = 4;
+    const auto consumers = 2;
+    const auto values    = 20000;
+    const auto total     = producers * values;
+
+    QLoggerQueue<int> queue(50);
+    QCOMPARE(queue.capacity(), 64);
+
+    std::vector<std::atomic<int>> seen(total);
+    std::atomic<int> popped { 0 };
+    std::atomic<int> unordered { 0 };
+    std::vector<std::thread> threads;
+
+    for (auto p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]() {
+            for (auto i = 0; i < values; ++i)
+            {
+                auto value = p * values + i;
+
+                while (!queue.tryPush(std::move(value)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    for (auto c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&]() {
+            std::vector<int> last(producers, -1);
+            auto value = 0;
+
+            while (popped.load() < total)
+            {
+                if (!queue.tryPop(value))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                auto &previous = last[value / values];
+
+                if (value % values <= previous)
+                    unordered.fetch_add(1);
+
+                previous = value % values;
+                seen[value].fetch_add(1);
+                popped.fetch_add(1);
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    const auto missing = std::count_if(seen.cbegin(), seen.cend(), [](const auto &count) { return count.load() != 1; });
+
+    QCOMPARE(popped.load(), total);
+    QCOMPARE(missing, 0);
+    QCOMPARE(unordered.load(), 0);
+    QVERIFY(queue.isEmpty());
+}
+
+/**
+ * @brief Several threads enqueue in the same writer at the same time: every message is written once, and the
+ * messages of each thread in the order they were enqueued.
+ */
+void tst_QLogger::concurrentEnqueue()
+{
+    const auto threadCount = 4;
+    const auto messages    = 1500;
+    const QString module("Enqueue");
+
+    QLoggerWriter writer("enqueue.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+
+    std::vector<std::thread> threads;
+
+    for (auto t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (auto i = 0; i < messages; ++i)
+                writer.enqueue(makeRecord(&module, LogLevel::Info, QString("%1 %2").arg(t).arg(i)));
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    // Without writer thread, the messages are written by the close
+    writer.closeDestination();
+
+    auto lines = readLines(writer.getFileDestination());
+
+    QCOMPARE(lines.size(), threadCount * messages + 1);
+    QVERIFY(lines.takeLast().startsWith("Closed "));
+
+    std::vector<int> next;
+
+    QCOMPARE(unorderedLines(lines, threadCount, next), 0);
+    QCOMPARE(next, std::vector<int>(threadCount, messages));
+}
+
+/**
+ * @brief Several threads log in the same module at the same time, through the snapshot of the modules: every
+ * message is in the file once and in order.
+ */
+void tst_QLogger::concurrentLogging()
+{
+    const auto threadCount = 4;
+    const auto messages    = 1000;
+
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("Concurrent");
+
+    manager->addDestination("concurrent.log", module, LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    std::vector<std::thread> threads;
+
+    for (auto t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (auto i = 0; i < messages; ++i)
+                QLog_Info(module, QString("%1 %2").arg(t).arg(i));
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    QLog_Info(module, QStringLiteral("Last"));
+
+    const auto path = filePath("concurrent.log");
+
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(path).size(), threadCount * messages + 1, 10000);
+
+    auto lines = readLines(path);
+    QCOMPARE(lines.takeLast(), QStringLiteral("Last"));
+
+    std::vector<int> next;
+
+    QCOMPARE(unorderedLines(lines, threadCount, next), 0);
+    QCOMPARE(next, std::vector<int>(threadCount, messages));
+}
+
+/**
+ * @brief The messages of a module without destination are kept and written first, in order, when it is added.
+ */
+void tst_QLogger::messagesBeforeDestination()
+{
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("Pending");
+
+    QLog_Info(module, QStringLiteral("First"));
+    QLog_Info(module, QStringLiteral("Second"));
+
+    manager->addDestination("pending.log", module, LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    QLog_Info(module, QStringLiteral("Third"));
+    QLog_Info(module, QStringLiteral("Last"));
+
+    const QStringList expected { "First", "Second", "Third", "Last" };
+
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(filePath("pending.log")), expected, 10000);
+}
+
+/**
+ * @brief The message of a QLog_* call below the level of the destination is not built, and the module is evaluated
+ * once whether the message is written or not.
+ */
+void tst_QLogger::levelCheckBeforeMessage()
+{
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("LevelCheck");
+
+    manager->addDestination("level.log", module, LogLevel::Warning, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    auto messages = 0;
+    auto modules  = 0;
+
+    const auto message = [&messages]() {
+        ++messages;
+        return QStringLiteral("Message");
+    };
+    const auto moduleName = [&modules, &module]() {
+        ++modules;
+        return module;
+    };
+
+    QVERIFY(!manager->isEnabled(module, LogLevel::Info));
+    QVERIFY(manager->isEnabled(module, LogLevel::Warning));
+
+    QLog_Info(moduleName(), message());
+    QCOMPARE(messages, 0);
+    QCOMPARE(modules, 1);
+
+    QLog_Warning(moduleName(), message());
+    QCOMPARE(messages, 1);
+    QCOMPARE(modules, 2);
+}
+
+/**
+ * @brief The QLog_* calls below QLOGGER_MIN_LEVEL are removed with their arguments, even when the destination has
+ * a lower level. This file is built without QLOGGER_MIN_LEVEL, so with every level.
+ */
+void tst_QLogger::compileTimeLevel()
+{
+    QVERIFY(isCompiledLevel(LogLevel::Trace));
+
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("CompileTime");
+
+    manager->addDestination("compiletime.log", module, LogLevel::Trace, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    QCOMPARE(logAtEveryLevel(module), 3);
+
+    QLog_Info(module, QStringLiteral("Last"));
+
+    const QStringList expected { "Warning", "Error", "Fatal", "Last" };
+
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(filePath("compiletime.log")), expected, 10000);
+}
+
+/**
+ * @brief The records keep the raw values of the messages and the writer formats them with its display options.
+ */
+void tst_QLogger::formatOnWriterThread()
+{
+    static const QString module("Deferred");
+    static const LogCallSite site { "formatOnWriterThread", "tst_qlogger.cpp", __LINE__, LogLevel::Warning };
+
+    QLoggerWriter writer("deferred.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::LogLevel | LogMessageDisplay::ModuleName | LogMessageDisplay::Message);
+
+    auto record = makeRecord(&module, LogLevel::Warning, QStringLiteral("Formatted by the writer"));
+    record.site = &site;
+
+    writer.enqueue(std::move(record));
+
+    // Changed after the enqueue, before the record is formatted
+    writer.setMessageOptions(LogMessageDisplay::ModuleName | LogMessageDisplay::Message);
+    writer.closeDestination();
+
+    QCOMPARE(readLines(writer.getFileDestination()).value(0), QStringLiteral("[Deferred] Formatted by the writer"));
+}
+
+/**
+ * @brief The ticks don't go back, they convert to the wall-clock time, and the cached prefix of the timestamps gives
+ * the same text as QDateTime within a second and across seconds.
+ */
+void tst_QLogger::clock()
+{
+    auto previous = QLoggerClock::now();
+
+    for (auto i = 0; i < 1000; ++i)
+    {
+        const auto tick = QLoggerClock::now();
+        QVERIFY(tick >= previous);
+        previous = tick;
+    }
+
+    QVERIFY(qAbs(QLoggerClock::currentMSecsSinceEpoch() - QDateTime::currentMSecsSinceEpoch()) < 100);
+
+    QLoggerTimestamp timestamp;
+    const auto start = QDateTime::currentMSecsSinceEpoch() / 1000 * 1000;
+
+    for (const auto offset : { 0, 1, 999, 1000, 1001, 61999, 86400000 })
+    {
+        const auto msecs    = start + offset;
+        const auto dateTime = QDateTime::fromMSecsSinceEpoch(msecs);
+
+        QCOMPARE(timestamp.format(msecs), dateTime.toString("yyyy-MM-dd hh:mm:ss:zzz"));
+        QCOMPARE(timestamp.date(msecs), dateTime.date());
+    }
+}
+
+/**
+ * @brief A thread keeps its identifier and other threads get other ones. The lines display the name given to a
+ * thread, and its identifier again once the name is removed.
+ */
+void tst_QLogger::threadId()
+{
+    const auto id = QLoggerThread::currentId();
+    auto otherId  = id;
+
+    QCOMPARE(QLoggerThread::currentId(), id);
+
+    std::thread([&otherId]() { otherId = QLoggerThread::currentId(); }).join();
+    QVERIFY(otherId != id);
+
+    static const QString module("ThreadId");
+
+    const auto hexId   = QString("%1").arg(id, QT_POINTER_SIZE * 2, 16, QLatin1Char('0'));
+    const auto written = [this](const QString &fileName) {
+        QLoggerWriter writer(fileName, LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                             LogMessageDisplay::ThreadId | LogMessageDisplay::Message);
+        writer.enqueue(makeRecord(&module, LogLevel::Info, QStringLiteral("Message")));
+        writer.closeDestination();
+
+        return readLines(writer.getFileDestination()).value(0);
+    };
+
+    QCOMPARE(QLoggerThread::displayName(id), hexId);
+    QCOMPARE(written("threadid.log"), QString("[%1] Message").arg(hexId));
+
+    const auto generation = QLoggerThread::generation();
+
+    QLoggerThread::setCurrentName(QStringLiteral("Main"));
+    QVERIFY(QLoggerThread::generation() != generation);
+    QCOMPARE(written("threadname.log"), QStringLiteral("[Main] Message"));
+
+    QLoggerThread::setCurrentName(QString());
+    QCOMPARE(QLoggerThread::displayName(id), hexId);
+}
+
+/**
+ * @brief Each writer appends its batches to the file, encoded in UTF-8, and the lines of a previous writer of the
+ * same file are kept.
+ */
+void tst_QLogger::appendToFile()
+{
+    static const QString module("Append");
+
+    const auto text = QString::fromUtf8("Writer %1, line %2: caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80");
+
+    QString path;
+
+    for (auto w = 0; w < 2; ++w)
+    {
+        QLoggerWriter writer("append.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                             LogMessageDisplay::Message);
+
+        for (auto i = 0; i < 3; ++i)
+            writer.enqueue(makeRecord(&module, LogLevel::Info, text.arg(w).arg(i)));
+
+        writer.closeDestination();
+        path = writer.getFileDestination();
+    }
+
+    const auto lines = readLines(path);
+
+    QCOMPARE(lines.size(), 8);
+
+    for (auto w = 0; w < 2; ++w)
+    {
+        for (auto i = 0; i < 3; ++i)
+            QCOMPARE(lines.at(w * 4 + i), text.arg(w).arg(i));
+
+        QVERIFY(lines.at(w * 4 + 3).startsWith("Closed "));
+    }
+}
+
+/**
+ * @brief The modules that log in the same file, named with or without its extension, share one writer and their
+ * messages are in the file in the order they were logged.
+ */
+void tst_QLogger::sharedWriter()
+{
+    const auto manager = QLoggerManager::getInstance();
+    const auto display = LogMessageDisplay::ModuleName | LogMessageDisplay::Message;
+
+    QCOMPARE(QLoggerWriter::destinationPath("shared", mFolder.path()), filePath("shared.log"));
+
+    manager->addDestination("shared.log", "SharedA", LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, display, false);
+    manager->addDestination("shared", "SharedB", LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, display, false);
+    manager->addDestination("notshared.log", "SharedC", LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, display, false);
+
+    const auto modules = manager->getModules();
+
+    QCOMPARE(modules.value("SharedA"), modules.value("SharedB"));
+    QVERIFY(modules.value("SharedA") != modules.value("SharedC"));
+
+    QLog_Info("SharedA", QStringLiteral("First"));
+    QLog_Info("SharedB", QStringLiteral("Second"));
+    QLog_Info("SharedA", QStringLiteral("Last"));
+
+    const QStringList expected { "[SharedA] First", "[SharedB] Second", "[SharedA] Last" };
+
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(filePath("shared.log")), expected, 10000);
+}
+
+void tst_QLogger::overflowPolicy_data()
+{
+    QTest::addColumn<LogOverflowPolicy>("policy");
+    QTest::addColumn<QStringList>("kept");
+
+    QTest::newRow("DropNewest") << LogOverflowPolicy::DropNewest
+                                << QStringList { "0", "1", "2", "3", "4", "5", "6", "7" };
+    QTest::newRow("DropOldest") << LogOverflowPolicy::DropOldest
+                                << QStringList { "12", "13", "14", "15", "16", "17", "18", "19" };
+    QTest::newRow("Sample") << LogOverflowPolicy::Sample << QStringList();
+}
+
+/**
+ * @brief A writer without thread gets more messages than its queue holds: the policy chooses the messages kept, the
+ * others are counted and reported in the file.
+ */
+void tst_QLogger::overflowPolicy()
+{
+    QFETCH(LogOverflowPolicy, policy);
+    QFETCH(QStringList, kept);
+
+    const auto capacity = 8;
+    const auto messages = 20;
+    static const QString module("Overflow");
+
+    QLoggerWriter writer(QString("overflow-%1.log").arg(QTest::currentDataTag()), LogLevel::Info, mFolder.path(),
+                         LogMode::OnlyFile, LogFileDisplay::Number, LogMessageDisplay::Message);
+    writer.setQueueCapacity(capacity);
+    writer.setOverflowPolicy(policy, 4);
+
+    for (auto i = 0; i < messages; ++i)
+        writer.enqueue(makeRecord(&module, LogLevel::Info, QString::number(i)));
+
+    writer.closeDestination();
+
+    const auto lines = readLines(writer.getFileDestination());
+
+    const auto summary = QString("%1 messages were discarded because the queue was full").arg(messages - capacity);
+
+    QCOMPARE(lines.size(), capacity + 2);
+    QCOMPARE(lines.at(capacity), summary);
+
+    if (!kept.isEmpty())
+        QCOMPARE(lines.mid(0, capacity), kept);
+}
+
+/**
+ * @brief With LogOverflowPolicy::Block the producers wait for the writer thread instead of losing messages, even
+ * with a queue much smaller than what they log.
+ */
+void tst_QLogger::blockingQueue()
+{
+    const auto threadCount = 4;
+    const auto messages    = 2000;
+    static const QString module("Block");
+
+    QLoggerWriter writer("block.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+    writer.setQueueCapacity(8);
+    writer.setOverflowPolicy(LogOverflowPolicy::Block);
+    writer.start();
+
+    std::vector<std::thread> threads;
+
+    for (auto t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (auto i = 0; i < messages; ++i)
+                writer.enqueue(makeRecord(&module, LogLevel::Info, QString("%1 %2").arg(t).arg(i)));
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    writer.closeDestination();
+    QVERIFY(writer.wait(10000));
+
+    auto lines = readLines(writer.getFileDestination());
+    lines.removeIf([](const QString &line) { return line.startsWith("Closed "); });
+
+    // The last batch of the thread and the one written by the close can be in any order
+    std::sort(lines.begin(), lines.end(), [](const QString &first, const QString &second) {
+        return std::make_pair(first.split(' ').at(0).toInt(), first.split(' ').at(1).toInt())
+            < std::make_pair(second.split(' ').at(0).toInt(), second.split(' ').at(1).toInt());
+    });
+
+    std::vector<int> next;
+
+    QCOMPARE(lines.size(), threadCount * messages);
+    QCOMPARE(unorderedLines(lines, threadCount, next), 0);
+    QCOMPARE(next, std::vector<int>(threadCount, messages));
+}
+
+/**
+ * @brief A file compressed in the background with LogCompression::Gzip is replaced by a valid .gz file of the same
+ * content.
+ */
+void tst_QLogger::gzipCompression()
+{
+    const auto path = filePath("compressed.log");
+
+    QByteArray content;
+
+    for (auto i = 0; i < 5000; ++i)
+        content.append(QString("Line %1 of the compressed file\n").arg(i).toUtf8());
+
+    writeFile(path, content);
+
+    const auto compressor = QLoggerCompressor::getInstance();
+
+    QVERIFY(!compressor->compress(path, LogCompression::None, 9));
+    QVERIFY(compressor->compress(path, LogCompression::Gzip, 6));
+    QVERIFY(compressor->waitForDone(10000));
+    QVERIFY(!QFile::exists(path));
+
+    QFile file(path + ".gz");
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    const auto gzip = file.readAll();
+
+    QVERIFY(gzip.startsWith("\x1f\x8b\x08"));
+    QVERIFY(gzip.size() < content.size() / 4);
+    QCOMPARE(gunzip(gzip, content), content);
+}
+
+/**
+ * @brief A destination that rotates by size: every rotated file reached the limit, the next file starts with its name
+ * and, in order, the files hold every message once. Each writer continues the numbers and the size of the previous
+ * one.
+ */
+void tst_QLogger::sizeRotation()
+{
+    const auto maxFileSize = 1024;
+    static const QString module("Rotation");
+
+    QStringList messages;
+    QString path;
+
+    for (auto w = 0; w < 20; ++w)
+    {
+        QLoggerWriter writer("rotation.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                             LogMessageDisplay::Message);
+        writer.setMaxFileSize(maxFileSize);
+        writer.setCompression(LogCompression::None);
+
+        for (auto i = 0; i < 10; ++i)
+        {
+            messages.append(QString("Message %1 of the rotation test").arg(w * 10 + i, 4, 10, QLatin1Char('0')));
+            writer.enqueue(makeRecord(&module, LogLevel::Info, messages.constLast()));
+        }
+
+        writer.closeDestination();
+        path = writer.getFileDestination();
+    }
+
+    auto files = rotatedFiles(mFolder.path(), "rotation");
+
+    QVERIFY(files.size() >= 3);
+
+    files.append(path);
+
+    QStringList written;
+
+    for (auto i = 0; i < files.size(); ++i)
+    {
+        const auto lines = readLines(files.at(i));
+
+        if (i > 0)
+            QCOMPARE(lines.value(0), QString("Previous log %1").arg(files.at(i - 1)));
+
+        if (i < files.size() - 1)
+            QVERIFY(QFileInfo(files.at(i)).size() >= maxFileSize);
+
+        for (const auto &line : lines)
+        {
+            if (!line.startsWith("Previous log ") && !line.startsWith("Closed "))
+                written.append(line);
+        }
+    }
+
+    QCOMPARE(written, messages);
+}
+
+/**
+ * @brief A file of the previous day is renamed with its date on the first write, with a number if a file of that
+ * date already exists.
+ */
+void tst_QLogger::dateRotation()
+{
+    static const QString module("DateRotation");
+
+    const auto path      = filePath("dated.log");
+    const auto yesterday = QDateTime::currentDateTime().addDays(-1);
+    const auto dated     = filePath(QString("dated_%1.log").arg(yesterday.toString("yyyy_MM_dd")));
+    const auto numbered  = filePath(QString("dated_%1(2).log").arg(yesterday.toString("yyyy_MM_dd")));
+
+    writeFile(path, "Yesterday\n");
+    writeFile(dated, "Already rotated\n");
+
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::Append));
+        QVERIFY(file.setFileTime(yesterday, QFileDevice::FileModificationTime));
+    }
+
+    QLoggerWriter writer("dated.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+    writer.setCompression(LogCompression::None);
+    writer.enqueue(makeRecord(&module, LogLevel::Info, QStringLiteral("Today")));
+    writer.closeDestination();
+
+    QCOMPARE(readLines(dated), QStringList { "Already rotated" });
+    QCOMPARE(readLines(numbered), QStringList { "Yesterday" });
+
+    const auto lines = readLines(path);
+
+    QCOMPARE(lines.value(0), QString("Previous log %1").arg(numbered));
+    QCOMPARE(lines.value(1), QStringLiteral("Today"));
+}
+
+/**
+ * @brief A batch is written when it reaches its message limit or when its oldest message has waited the maximum
+ * latency, not before.
+ */
+void tst_QLogger::flushPolicy()
+{
+    static const QString module("Flush");
+
+    QLoggerWriter writer("flush.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+    writer.setFlushPolicy(60000, 10, 0);
+    writer.start();
+
+    for (auto i = 0; i < 9; ++i)
+        writer.enqueue(makeRecord(&module, LogLevel::Info, QString::number(i)));
+
+    QTest::qWait(300);
+    QVERIFY(readLines(writer.getFileDestination()).isEmpty());
+
+    writer.enqueue(makeRecord(&module, LogLevel::Info, QStringLiteral("9")));
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(writer.getFileDestination()).size(), 10, 5000);
+
+    writer.setFlushPolicy(200, 0, 0);
+    writer.enqueue(makeRecord(&module, LogLevel::Info, QStringLiteral("Late")));
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(writer.getFileDestination()).size(), 11, 5000);
+    QCOMPARE(readLines(writer.getFileDestination()).constLast(), QStringLiteral("Late"));
+
+    writer.closeDestination();
+    QVERIFY(writer.wait(10000));
+}
+
+/**
+ * @brief Only the messages at or above the flush level are in the file when the call that logs them returns, and the
+ * older messages with them. flush() waits for all the messages enqueued before.
+ */
+void tst_QLogger::writeThrough()
+{
+    static const QString module("Durability");
+
+    QLoggerWriter writer("durability.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+    writer.setFlushPolicy(60000, 0, 0);
+    writer.setDurability(LogLevel::Fatal, 0);
+    writer.start();
+
+    writer.enqueue(makeRecord(&module, LogLevel::Error, QStringLiteral("Error")));
+    QVERIFY(readLines(writer.getFileDestination()).isEmpty());
+
+    writer.enqueue(makeRecord(&module, LogLevel::Fatal, QStringLiteral("Fatal")));
+    QCOMPARE(readLines(writer.getFileDestination()), QStringList({ "Error", "Fatal" }));
+
+    writer.enqueue(makeRecord(&module, LogLevel::Info, QStringLiteral("Info")));
+    writer.flush();
+    QCOMPARE(readLines(writer.getFileDestination()).size(), 3);
+
+    writer.closeDestination();
+    QVERIFY(writer.wait(10000));
+}
+
+/**
+ * @brief A ring that wrapped around keeps its newest records in order, synced or not, and a ring opened again with the
+ * same size continues after them.
+ */
+void tst_QLogger::memoryMappedRing()
+{
+    static const QString module("Ring");
+    const auto path     = filePath("memory.ring");
+    const auto messages = 5000;
+
+    {
+        QLoggerRing ring(path, 64 * 1024);
+        QVERIFY(ring.isOpen());
+
+        for (auto i = 0; i < messages; ++i)
+        {
+            ring.append(makeRecord(&module, LogLevel::Info, QString::number(i)));
+
+            if (i % 1000 == 0)
+                ring.sync();
+        }
+
+        ring.sync();
+    }
+
+    QString error;
+    auto entries = QLoggerRing::read(path, &error);
+
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+    QVERIFY(!entries.isEmpty());
+    QVERIFY(entries.constFirst().message.toInt() > 0);
+    QCOMPARE(entries.constLast().message, QString::number(messages - 1));
+
+    for (auto i = 1; i < entries.size(); ++i)
+    {
+        QCOMPARE(entries.at(i).module, module);
+        QCOMPARE(entries.at(i).message.toInt(), entries.at(i - 1).message.toInt() + 1);
+    }
+
+    {
+        QLoggerRing ring(path, 64 * 1024);
+        ring.append(makeRecord(&module, LogLevel::Info, QStringLiteral("Again")));
+    }
+
+    entries = QLoggerRing::read(path);
+
+    QCOMPARE(entries.constLast().message, QStringLiteral("Again"));
+    QCOMPARE(entries.at(entries.size() - 2).message, QString::number(messages - 1));
+}
+
+/**
+ * @brief The records written in LogFormat::Binary by two writers of the same file read back with their time, level,
+ * module, call site and message, new lines and non-ASCII characters included.
+ */
+void tst_QLogger::binaryFormat()
+{
+    static const QString module("Binary");
+    static const LogCallSite sites[] = { { "binaryFormat", "tst_qlogger.cpp", __LINE__, LogLevel::Info },
+                                         { "other", "other.cpp", __LINE__, LogLevel::Error } };
+
+    const auto text = QString::fromUtf8("Line %1\nwith a new line, \xc3\xa9 and \xf0\x9f\x98\x80");
+
+    QVector<LogRecord> records;
+
+    for (auto i = 0; i < 300; ++i)
+    {
+        auto record = makeRecord(&module, i % 2 ? LogLevel::Error : LogLevel::Info, text.arg(i));
+        record.site = &sites[i % 3 ? 0 : 1];
+        records.append(record);
+    }
+
+    // The second writer appends to the file of the first one
+    for (auto segment = 0; segment < 2; ++segment)
+    {
+        QLoggerWriter writer("binary.qlog", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                             LogMessageDisplay::Default);
+        writer.setFormat(LogFormat::Binary);
+        writer.setCompression(LogCompression::None);
+        writer.start();
+
+        for (auto i = segment * 150; i < (segment + 1) * 150; ++i)
+        {
+            auto record = records.at(i);
+            writer.enqueue(std::move(record));
+        }
+
+        writer.closeDestination();
+        QVERIFY(writer.wait(10000));
+    }
+
+    QString error;
+    const auto entries = QLoggerBinary::read(filePath("binary.qlog"), &error);
+
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+
+    // The lines written by the writers themselves, as the one of the close, are already formatted
+    QVector<LogEntry> read;
+
+    for (const auto &entry : entries)
+    {
+        if (!entry.formatted)
+            read.append(entry);
+    }
+
+    QCOMPARE(read.size(), records.size());
+
+    for (auto i = 0; i < read.size(); ++i)
+    {
+        const auto &entry  = read.at(i);
+        const auto &record = records.at(i);
+
+        QCOMPARE(entry.msecsSinceEpoch, QLoggerClock::toMSecsSinceEpoch(record.timestamp));
+        QCOMPARE(entry.level, record.level);
+        QCOMPARE(entry.module, module);
+        QCOMPARE(entry.function, QString::fromLatin1(record.site->function));
+        QCOMPARE(entry.file, QString::fromLatin1(record.site->file));
+        QCOMPARE(entry.line, record.site->line);
+        QCOMPARE(entry.message, record.message);
+    }
+}
+
+/**
+ * @brief The fields of a structured message are written as key=value after the message, quoted when needed, or as
+ * typed members of the JSON object of the line. The module of the macro is evaluated once.
+ */
+void tst_QLogger::structuredFields()
+{
+    const auto manager = QLoggerManager::getInstance();
+    static const QString module("Fields");
+
+    manager->addDestination("fields.log", module, LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    auto evaluated = 0;
+    const auto moduleOf = [&evaluated]() -> const QString & {
+        ++evaluated;
+        return module;
+    };
+
+    QLog_InfoKV(moduleOf(), "Done", "status", 200, "ratio", 0.25, "ok", true, "name", "two words");
+
+    QCOMPARE(evaluated, 1);
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(filePath("fields.log")),
+                              QStringList({ "Done status=200 ratio=0.25 ok=true name=\"two words\"" }), 5000);
+
+    QLoggerWriter writer("fields.json", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message | LogMessageDisplay::Json);
+
+    auto record   = makeRecord(&module, LogLevel::Info, QStringLiteral("Done"));
+    record.fields = makeFields("status", 200, "ratio", 0.25, "ok", true, "name", "two words");
+    writer.enqueue(std::move(record));
+    writer.closeDestination();
+
+    const auto object = QJsonDocument::fromJson(readLines(writer.getFileDestination()).value(0).toUtf8()).object();
+
+    QCOMPARE(object.value("message").toString(), QStringLiteral("Done"));
+    QCOMPARE(object.value("status").toInt(), 200);
+    QVERIFY(object.value("ratio").isDouble());
+    QCOMPARE(object.value("ratio").toDouble(), 0.25);
+    QVERIFY(object.value("ok").isBool());
+    QVERIFY(object.value("ok").toBool());
+    QCOMPARE(object.value("name").toString(), QStringLiteral("two words"));
+}
+
+/**
+ * @brief Only the oldest messages of a module without destination are kept, up to the limit, with their fields.
+ */
+void tst_QLogger::preRegistrationLimit()
+{
+    const auto manager = QLoggerManager::getInstance();
+    static const QString module("PendingLimit");
+
+    manager->setPreRegistrationLimit(3);
+
+    for (auto i = 0; i < 5; ++i)
+        QLog_InfoKV(module, QString::number(i), "index", i);
+
+    manager->setPreRegistrationLimit(100);
+    manager->addDestination("pendinglimit.log", module, LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    const QStringList expected { "0 index=0", "1 index=1", "2 index=2" };
+
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(filePath("pendinglimit.log")), expected, 5000);
+}
+
+/**
+ * @brief A handle taken before the destination is added logs in it once it is, the handle argument of the macros is
+ * evaluated once and the message of a discarded level is not evaluated.
+ */
+void tst_QLogger::moduleHandle()
+{
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("Handle");
+    const auto handle = manager->module(module);
+
+    QVERIFY(handle.isValid());
+
+    QLog_InfoH(handle, QStringLiteral("Before"));
+
+    manager->addDestination("handle.log", module, LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    auto evaluated = 0;
+    const auto handleOf = [&]() -> const ModuleHandle & {
+        ++evaluated;
+        return handle;
+    };
+    const auto messageOf = [&](const QString &message) {
+        ++evaluated;
+        return message;
+    };
+
+    QLog_DebugH(handle, messageOf(QStringLiteral("Discarded")));
+    QLog_InfoH(handleOf(), QStringLiteral("After"));
+
+    QCOMPARE(evaluated, 1);
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(filePath("handle.log")), QStringList({ "Before", "After" }), 5000);
+}
+
+/**
+ * @brief The macros give the line and the name of their file without the folders, and the messages logged with the
+ * function and file as text get the same site each time.
+ */
+void tst_QLogger::callSite()
+{
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("CallSite");
+
+    manager->addDestination("callsite.log", module, LogLevel::Debug, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::File | LogMessageDisplay::Line
+                                | LogMessageDisplay::Message,
+                            false);
+
+    const auto line = __LINE__ + 1;
+    QLog_Debug(module, QStringLiteral("Macro"));
+
+    for (auto i = 0; i < 2; ++i)
+        QLog_(module, LogLevel::Debug, QStringLiteral("Text"), "callSite", "/some/folder/legacy.cpp", 42);
+
+    const QStringList expected { QString("{tst_qlogger.cpp:%1} Macro").arg(line), "{legacy.cpp:42} Text",
+                                 "{legacy.cpp:42} Text" };
+
+    QTRY_COMPARE_WITH_TIMEOUT(readLines(filePath("callsite.log")), expected, 5000);
+}
+
+/**
+ * @brief The console lines go to the standard error from the warnings up, and the color of a line is reset before its
+ * new line.
+ */
+void tst_QLogger::consoleLines()
+{
+    const auto console = QLoggerConsole::getInstance();
+    const QByteArray line("Message\n");
+
+    QVERIFY(!QLoggerConsole::isError(LogLevel::Info));
+    QVERIFY(QLoggerConsole::isError(LogLevel::Warning));
+    QVERIFY(QLoggerConsole::isError(LogLevel::Fatal));
+
+    QByteArray plain;
+    console->appendLine(plain, LogLevel::Error, line.constData(), line.size());
+    QCOMPARE(plain, line);
+
+    console->setColors(true);
+
+    QByteArray colored;
+    console->appendLine(colored, LogLevel::Error, line.constData(), line.size());
+
+    console->setColors(false);
+
+    QCOMPARE(colored, QByteArray("\x1b[31mMessage\x1b[0m\n"));
+}
+
+/**
+ * @brief The UDP sink packs the lines in datagrams of the maximum size and cuts a longer line on a UTF-8 character
+ * boundary.
+ */
+void tst_QLogger::udpSink()
+{
+    static const QString module("Udp");
+
+    QUdpSocket collector;
+    QVERIFY(collector.bind(QHostAddress::LocalHost));
+
+    QLoggerWriter writer("udp.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+
+    QLoggerNetworkSink sink("127.0.0.1", collector.localPort(), LogProtocol::Udp, LogNetworkFormat::Lines);
+    sink.setMaxDatagramSize(102);
+
+    // 2 bytes per character: an odd size falls in the middle of one
+    sink.write(writer, { makeRecord(&module, LogLevel::Info, QString(200, QChar(0xE9))),
+                         makeRecord(&module, LogLevel::Info, QStringLiteral("Short")) });
+
+    QList<QByteArray> datagrams;
+
+    while (datagrams.size() < 2 && collector.waitForReadyRead(5000))
+    {
+        while (collector.hasPendingDatagrams())
+        {
+            QByteArray datagram(static_cast<qsizetype>(collector.pendingDatagramSize()), '\0');
+            collector.readDatagram(datagram.data(), datagram.size());
+            datagrams.append(datagram);
+        }
+    }
+
+    QCOMPARE(datagrams.size(), 2);
+    QCOMPARE(datagrams.at(0).size(), 101);
+    QVERIFY(datagrams.at(0).endsWith('\n'));
+    QCOMPARE(QString::fromUtf8(datagrams.at(0)).toUtf8(), datagrams.at(0));
+    QCOMPARE(datagrams.at(1), QByteArray("Short\n"));
+}
+
+/**
+ * @brief More destinations than threads in the pool, each shared by two modules logging at the same time: every file
+ * gets all the messages of its modules, in the order of each module.
+ */
+void tst_QLogger::writerPool()
+{
+    const auto files    = 6;
+    const auto messages = 2000;
+
+    const auto manager = QLoggerManager::getInstance();
+
+    for (auto f = 0; f < files; ++f)
+    {
+        const QStringList modules { QString("Pool%1a").arg(f), QString("Pool%1b").arg(f) };
+
+        manager->addDestination(QString("pool-%1.log").arg(f), modules, LogLevel::Info, mFolder.path(),
+                                LogMode::OnlyFile, LogFileDisplay::Number,
+                                LogMessageDisplay::ModuleName | LogMessageDisplay::Message, false);
+    }
+
+    std::vector<std::thread> threads;
+
+    for (auto t = 0; t < files * 2; ++t)
+    {
+        threads.emplace_back([t]() {
+            const auto module = QString("Pool%1%2").arg(t / 2).arg(QLatin1Char(t % 2 ? 'b' : 'a'));
+            const auto handle = QLoggerManager::getInstance()->module(module);
+
+            for (auto i = 0; i < messages; ++i)
+                QLog_InfoH(handle, QString::number(i));
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    manager->flushAll();
+
+    for (auto f = 0; f < files; ++f)
+    {
+        const auto first  = QString("Pool%1a").arg(f);
+        const auto second = QString("Pool%1b").arg(f);
+        const auto lines  = readLines(filePath(QString("pool-%1.log").arg(f)));
+
+        QHash<QString, int> next;
+
+        for (const auto &line : lines)
+        {
+            const auto parts = line.split(QLatin1Char(' '));
+            auto &expected   = next[parts.constFirst()];
+
+            QCOMPARE(parts.size(), 2);
+            QCOMPARE(parts.constLast().toInt(), expected);
+            ++expected;
+        }
+
+        QCOMPARE(lines.size(), 2 * messages);
+        QCOMPARE(next.value(QString("[%1]").arg(first)), messages);
+        QCOMPARE(next.value(QString("[%1]").arg(second)), messages);
+        QCOMPARE(manager->getModules().value(first), manager->getModules().value(second));
+    }
+}
+
+/**
+ * @brief A flood from one call site is limited to its budget, the number of suppressed messages is written once the
+ * flood stops, without a flush, and another call site of the module keeps its own budget.
+ */
+void tst_QLogger::rateLimit()
+{
+    const auto messages = 1000;
+
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("Rate");
+    const auto path = filePath("rate.log");
+
+    manager->addDestination("rate.log", module, LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+    manager->setRateLimit(module, LogLevel::Info, 10, 5, LogRateScope::CallSite);
+
+    for (auto i = 0; i < messages; ++i)
+        QLog_Info(module, QString("Flood %1").arg(i));
+
+    const auto isReported = [&path]() {
+        const auto lines = readLines(path);
+
+        return std::any_of(lines.cbegin(), lines.cend(),
+                           [](const QString &line) { return line.endsWith(" messages suppressed"); });
+    };
+
+    QTRY_VERIFY_WITH_TIMEOUT(isReported(), 5000);
+
+    for (auto i = 0; i < 3; ++i)
+        QLog_Info(module, QString("Other %1").arg(i));
+
+    manager->flushAll();
+
+    auto flood      = 0;
+    auto other      = 0;
+    auto suppressed = 0;
+
+    for (const auto &line : readLines(path))
+    {
+        if (line.startsWith("Flood "))
+            ++flood;
+        else if (line.startsWith("Other "))
+            ++other;
+        else if (line.endsWith(" messages suppressed"))
+            suppressed += line.split(QLatin1Char(' ')).constFirst().toInt();
+        else
+            QFAIL(qPrintable(line));
+    }
+
+    QVERIFY(flood >= 5 && flood < messages / 10);
+    QCOMPARE(flood + suppressed, messages);
+    QCOMPARE(other, 3);
+
+    manager->setRateLimit(module, LogLevel::Info, 0);
+}
+
+void tst_QLogger::stats()
+{
+    const auto messages = 100;
+
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("Stats");
+    const auto prometheus = filePath("stats.prom");
+
+    manager->addDestination("stats.log", module, LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    for (auto i = 0; i < messages; ++i)
+        QLog_Info(module, QString("Message %1").arg(i));
+
+    manager->flushAll();
+
+    LogWriterStats writer;
+
+    for (const auto &stats : manager->stats().writers)
+    {
+        if (stats.fileDestination.endsWith("stats.log"))
+            writer = stats;
+    }
+
+    QCOMPARE(writer.enqueued, static_cast<quint64>(messages));
+    QCOMPARE(writer.written, writer.enqueued);
+    QCOMPARE(writer.dropped, quint64(0));
+    QVERIFY(writer.bytesWritten > 0);
+    QVERIFY(writer.batches > 0);
+    QCOMPARE(writer.batchSize.count, writer.batches);
+    QCOMPARE(writer.batchSize.sum, writer.written);
+    QVERIFY(writer.queueHighWater > 0 && writer.queueHighWater <= messages);
+
+    manager->setStatsExport(50, LogStatsFormat::Prometheus, prometheus);
+
+    QTRY_VERIFY_WITH_TIMEOUT(QFile::exists(prometheus), 5000);
+
+    manager->setStatsExport(0);
+
+    const auto lines = readLines(prometheus);
+
+    QVERIFY(lines.contains("# TYPE qlogger_messages_written_total counter"));
+    QVERIFY(std::any_of(lines.cbegin(), lines.cend(), [](const QString &line) {
+        return line.startsWith("qlogger_messages_written_total{") && line.contains("stats.log")
+            && line.endsWith(QString(" %1").arg(messages));
+    }));
+}
+
+void tst_QLogger::closeInParallel()
+{
+    static const QString module("Close");
+    const auto messages = 1000;
+
+    QLoggerWriter drained("close.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                          LogMessageDisplay::Message);
+    QLoggerWriter abandoned("abandoned.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message);
+
+    for (auto writer : { &drained, &abandoned })
+    {
+        writer->setFlushPolicy(60000, 0, 0);
+        writer->start();
+
+        for (auto i = 0; i < messages; ++i)
+            writer->enqueue(makeRecord(&module, LogLevel::Info, QString::number(i)));
+    }
+
+    // The abandoned destination closes without writing its queue
+    abandoned.abandonClose();
+    drained.requestClose();
+    abandoned.requestClose();
+
+    const QDeadlineTimer deadline(10000);
+
+    QVERIFY(drained.waitForClosed(deadline));
+    QVERIFY(abandoned.waitForClosed(deadline));
+    QVERIFY(drained.wait(10000));
+    QVERIFY(abandoned.wait(10000));
+
+    // The messages enqueued once closed are discarded
+    drained.enqueue(makeRecord(&module, LogLevel::Info, QStringLiteral("After")));
+
+    const auto lines = readLines(drained.getFileDestination());
+
+    QCOMPARE(lines.size(), messages + 1);
+    QCOMPARE(lines.constFirst(), QStringLiteral("0"));
+    QCOMPARE(lines.at(messages - 1), QString::number(messages - 1));
+    QVERIFY(lines.constLast().startsWith("Closed "));
+    QCOMPARE(drained.stats().dropped, quint64(0));
+
+    const auto abandonedLines = readLines(abandoned.getFileDestination());
+
+    QCOMPARE(abandonedLines.size(), 1);
+    QVERIFY(abandonedLines.constFirst().startsWith("Closed "));
+    QCOMPARE(abandoned.stats().dropped, static_cast<quint64>(messages));
+}
+
+void tst_QLogger::snapshotReclaim()
+{
+    QLoggerSnapshot<int> snapshot;
+
+    QVERIFY(!snapshot.read());
+
+    snapshot.publish(std::make_unique<const int>(1));
+    QVERIFY(!snapshot.hasRetired());
+
+    {
+        const auto reader = snapshot.read();
+
+        // The value being read is kept
+        snapshot.publish(std::make_unique<const int>(2));
+        QVERIFY(snapshot.hasRetired());
+        QCOMPARE(*reader, 1);
+        QCOMPARE(*snapshot.read(), 2);
+
+        snapshot.reclaim();
+        QVERIFY(snapshot.hasRetired());
+    }
+
+    snapshot.reclaim();
+    QVERIFY(!snapshot.hasRetired());
+    QCOMPARE(*snapshot.read(), 2);
+
+    // The writer settings change while other threads log
+    static const QString module("Snapshot");
+    const auto threadCount = 4;
+    const auto messages    = 2000;
+
+    QLoggerWriter writer("snapshot.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+    writer.start();
+
+    std::vector<std::thread> threads;
+
+    for (auto t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&writer, t]() {
+            for (auto i = 0; i < messages; ++i)
+                writer.enqueue(makeRecord(&module, LogLevel::Warning, QString("%1 %2").arg(t).arg(i)));
+        });
+    }
+
+    for (auto i = 0; i < 1000; ++i)
+        writer.setLogLevel(i % 2 ? LogLevel::Info : LogLevel::Debug);
+
+    for (auto &thread : threads)
+        thread.join();
+
+    writer.flush();
+
+    std::vector<int> next;
+
+    QCOMPARE(unorderedLines(readLines(writer.getFileDestination()), threadCount, next), 0);
+    QCOMPARE(next, std::vector<int>(threadCount, messages));
+
+    writer.closeDestination();
+    QVERIFY(writer.wait(10000));
+}
+
+void tst_QLogger::configReload()
+{
+    const auto iniPath = filePath("config.ini");
+
+    writeFile(iniPath, "level=Error\nmode=Full\npaused=true\nunknown=1\n\n[modules]\nNetwork=trace\nGui=none\n");
+
+    LogConfig config;
+
+    QVERIFY(LogConfig::read(iniPath, config));
+    QVERIFY(config.level == LogLevel::Error);
+    QVERIFY(config.mode == LogMode::Full);
+    QVERIFY(config.paused == true);
+    QCOMPARE(config.modules.size(), 1);
+    QCOMPARE(config.modules.value("Network"), LogLevel::Trace);
+
+    const auto threadCount = 2;
+
+    const auto manager = QLoggerManager::getInstance();
+    const QString module("Config");
+    const auto path   = filePath("config.log");
+    const auto handle = manager->module(module);
+
+    manager->addDestination("config.log", module, LogLevel::Info, mFolder.path(), LogMode::OnlyFile,
+                            LogFileDisplay::Number, LogMessageDisplay::Message, false);
+
+    // Only the level of this module is in the file, the other destinations are not touched
+    writeFile(iniPath, "[modules]\nConfig=Warning\n");
+
+    std::atomic<bool> quit { false };
+    std::vector<int> logged(threadCount, 0);
+    std::vector<std::thread> threads;
+
+    for (auto t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (auto i = 0; !quit.load(); ++i)
+            {
+                QLog_Warning(module, QString("%1 %2").arg(t).arg(i));
+                logged[t] = i + 1;
+            }
+        });
+    }
+
+    manager->watchConfigFile(iniPath, 20);
+
+    QTRY_VERIFY_WITH_TIMEOUT(!handle.isEnabled(LogLevel::Info), 5000);
+    QLog_Info(module, QStringLiteral("Info after the first reload"));
+
+    // A different size, so the change is seen even within the resolution of the modification time
+    writeFile(iniPath, "[modules]\nConfig=Debug\n\n");
+
+    QTRY_VERIFY_WITH_TIMEOUT(handle.isEnabled(LogLevel::Debug), 5000);
+    QLog_Debug(module, QStringLiteral("Debug after the second reload"));
+
+    manager->watchConfigFile(QString());
+
+    quit.store(true);
+
+    for (auto &thread : threads)
+        thread.join();
+
+    manager->flushAll();
+
+    auto lines = readLines(path);
+
+    QVERIFY(lines.removeOne("Debug after the second reload"));
+    QVERIFY(!lines.contains("Info after the first reload"));
+
+    std::vector<int> next;
+
+    QCOMPARE(unorderedLines(lines, threadCount, next), 0);
+    QCOMPARE(next, logged);
+}
+
+void tst_QLogger::retention()
+{
+    static const QString module("Retention");
+    const auto before = filePath("retention(2).log");
+
+    writeFile(before, "Rotated before the policy\n");
+
+    QLoggerWriter writer("retention.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+    writer.setMaxFileSize(512);
+    writer.setCompression(LogCompression::None);
+    writer.setRetention(LogRetention { 0, 0, 2 });
+    writer.start();
+
+    // Batches of 10 messages, so the file rotates every few batches
+    for (auto i = 0; i < 200; ++i)
+    {
+        writer.enqueue(makeRecord(&module, LogLevel::Info,
+                                  QString("Message %1 of the retention test").arg(i, 4, 10, QLatin1Char('0'))));
+
+        if (i % 10 == 9)
+            writer.flush();
+    }
+
+    QTRY_VERIFY_WITH_TIMEOUT(rotatedFiles(mFolder.path(), "retention").size() <= 2, 5000);
+
+    const auto files = rotatedFiles(mFolder.path(), "retention");
+
+    QVERIFY(!QFile::exists(before));
+    QCOMPARE(files.size(), 2);
+
+    // The newest rotations: the second one follows the first and the current file follows the second
+    QCOMPARE(readLines(files.value(1)).value(0), QString("Previous log %1").arg(files.value(0)));
+    QCOMPARE(readLines(writer.getFileDestination()).value(0), QString("Previous log %1").arg(files.value(1)));
+
+    QLoggerRetention::getInstance()->setPolicy(writer.getFileDestination(), LogRetention());
+
+    writer.closeDestination();
+    QVERIFY(writer.wait(10000));
+}
+
+void tst_QLogger::reusedBuffers()
+{
+    static const LogCallSite site { "tst_QLogger::reusedBuffers", "tst_qlogger.cpp", 42, LogLevel::Info };
+    static const QString module("Buffers");
+
+    QLoggerTimestamp timestamps;
+    QString text("Date ");
+    const auto now = QLoggerClock::currentMSecsSinceEpoch();
+
+    timestamps.append(text, now);
+    QCOMPARE(text, "Date " + timestamps.format(now));
+
+    QLoggerWriter writer("buffers.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Default);
+    writer.start();
+
+    // Shorter lines after longer ones: nothing of the previous batch is left in the buffers
+    QVector<LogRecord> records;
+
+    for (const auto length : { 2000, 10, 300, 1 })
+    {
+        auto record = makeRecord(&module, LogLevel::Info, QString(length, QLatin1Char('x')));
+        record.site = &site;
+        records.append(record);
+
+        writer.enqueue(std::move(record));
+        writer.flush();
+    }
+
+    writer.closeDestination();
+    QVERIFY(writer.wait(10000));
+
+    const auto lines = readLines(writer.getFileDestination());
+
+    QCOMPARE(lines.size(), records.size() + 1);
+
+    for (auto i = 0; i < records.size(); ++i)
+    {
+        QCOMPARE(lines.at(i).trimmed(), writer.formatRecord(records.at(i)).trimmed());
+        QVERIFY(lines.at(i).contains("{tst_qlogger.cpp:42}"));
+        QVERIFY(lines.at(i).endsWith(" " + records.at(i).message));
+    }
+}
+
+void tst_QLogger::utf8()
+{
+    // ASCII, Latin-1, the rest of the BMP and the characters out of it, in runs long enough to take the SIMD path
+    const QVector<QString> pieces { QString(20, QLatin1Char('a')), QStringLiteral("0123456789"),
+                                    QString::fromUtf8("\xc3\xa9\xc3\xbc"), QString::fromUtf8("\xe2\x82\xac"),
+                                    QString::fromUtf8("\xe4\xb8\xad\xe6\x96\x87"),
+                                    QString::fromUtf8("\xf0\x9f\x98\x80") };
+
+    quint32 random = 1;
+
+    for (auto i = 0; i < 500; ++i)
+    {
+        QString text;
+
+        while (text.size() < i % 90)
+        {
+            random = random * 1103515245 + 12345;
+            text.append(pieces.at((random >> 16) % pieces.size()));
+        }
+
+        QByteArray encoded;
+        QLoggerUtf8::append(encoded, text);
+
+        QCOMPARE(encoded, text.toUtf8());
+        QVERIFY(encoded.size() <= QLoggerUtf8::maxSize(text.size(), false));
+
+        QByteArray escaped;
+        QLoggerUtf8::append(escaped, text + QStringLiteral("\n\t"), true);
+
+        QCOMPARE(escaped, text.toUtf8() + "\\n\\t");
+        QVERIFY(escaped.size() <= QLoggerUtf8::maxSize(text.size() + 2, true));
+    }
+
+    // Unpaired surrogates
+    QByteArray replaced;
+    QLoggerUtf8::append(replaced, QString(QChar(0xD800)) + QLatin1Char('a') + QChar(0xDC00));
+    QCOMPARE(replaced, QByteArray("\xef\xbf\xbd" "a" "\xef\xbf\xbd"));
+
+    // The control characters in and after a block of ASCII characters
+    const auto control = QString(20, QLatin1Char('x')) + QStringLiteral("\n\r\t\x01\x7f\\") + QChar(0x2028)
+        + QChar(0x85) + QString::fromUtf8("\xc3\xa9");
+
+    QByteArray escaped;
+    QLoggerUtf8::append(escaped, control, true);
+    QCOMPARE(escaped, QByteArray(20, 'x') + "\\n\\r\\t\\x01\\x7f\\\\u2028\\u0085\xc3\xa9");
+
+    // A destination that escapes writes a message with new lines on one line
+    static const QString module("Escape");
+
+    QLoggerWriter writer("escape.log", LogLevel::Info, mFolder.path(), LogMode::OnlyFile, LogFileDisplay::Number,
+                         LogMessageDisplay::Message);
+    writer.setEscaping(true);
+    QVERIFY(writer.isEscaping());
+    writer.start();
+
+    writer.enqueue(makeRecord(&module, LogLevel::Info, QStringLiteral("first\nsecond\r\nthird")));
+    writer.closeDestination();
+    QVERIFY(writer.wait(10000));
+
+    QCOMPARE(readLines(writer.getFileDestination()).value(0).trimmed(), "first\\nsecond\\r\\nthird");
+}
+
+QTEST_MAIN(tst_QLogger)
+
+#include "tst_qlogger.moc"
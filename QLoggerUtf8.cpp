@@ -0,0 +1,209 @@
+#include "QLoggerUtf8.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define QLOGGER_UTF8_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define QLOGGER_UTF8_NEON
+#endif
+
+namespace
+{
+
+/**
+ * @brief The characters of a block checked at once by the fast path.
+ */
+constexpr qsizetype BLOCK = 16;
+
+const char HEX[] = "0123456789abcdef";
+
+/**
+ * @brief Narrows the blocks of ASCII characters at the start of a text. It stops at the first block that has a
+ * character that is not ASCII or, when escaping, a control character.
+ * @return The number of characters narrowed, a multiple of BLOCK.
+ */
+qsizetype narrowAscii(char *out, const char16_t *text, qsizetype size, bool escape)
+{
+    qsizetype i = 0;
+
+#if defined(QLOGGER_UTF8_SSE2)
+    const auto zero     = _mm_setzero_si128();
+    const auto nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const auto space    = _mm_set1_epi8(0x20);
+    const auto del      = _mm_set1_epi8(0x7F);
+
+    for (; i + BLOCK <= size; i += BLOCK)
+    {
+        const auto low  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+        const auto high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i + 8));
+        const auto bits = _mm_and_si128(_mm_or_si128(low, high), nonAscii);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(bits, zero)) != 0xFFFF)
+            break;
+
+        // Every character is below 0x80, so the saturation of the packing never applies
+        const auto bytes = _mm_packus_epi16(low, high);
+
+        if (escape && _mm_movemask_epi8(_mm_or_si128(_mm_cmplt_epi8(bytes, space), _mm_cmpeq_epi8(bytes, del))) != 0)
+            break;
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), bytes);
+    }
+#elif defined(QLOGGER_UTF8_NEON)
+    for (; i + BLOCK <= size; i += BLOCK)
+    {
+        const auto low  = vld1q_u16(reinterpret_cast<const uint16_t *>(text + i));
+        const auto high = vld1q_u16(reinterpret_cast<const uint16_t *>(text + i + 8));
+
+        if (vmaxvq_u16(vorrq_u16(low, high)) >= 0x80)
+            break;
+
+        const auto bytes = vcombine_u8(vmovn_u16(low), vmovn_u16(high));
+
+        if (escape && (vminvq_u8(bytes) < 0x20 || vmaxvq_u8(bytes) == 0x7F))
+            break;
+
+        vst1q_u8(reinterpret_cast<uint8_t *>(out + i), bytes);
+    }
+#else
+    Q_UNUSED(out);
+    Q_UNUSED(text);
+    Q_UNUSED(size);
+    Q_UNUSED(escape);
+#endif
+
+    return i;
+}
+
+char *appendHex(char *out, char prefix, char32_t value, int digits)
+{
+    *out++ = '\\';
+    *out++ = prefix;
+
+    for (auto shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+        *out++ = HEX[(value >> shift) & 0xF];
+
+    return out;
+}
+
+/**
+ * @brief Writes the escaped form of a control character or a line separator.
+ * @return The end of the escaped character, or nullptr if it is written as it is.
+ */
+char *appendEscaped(char *out, char16_t c)
+{
+    switch (c)
+    {
+        case u'\n':
+            *out++ = '\\';
+            *out++ = 'n';
+            return out;
+        case u'\r':
+            *out++ = '\\';
+            *out++ = 'r';
+            return out;
+        case u'\t':
+            *out++ = '\\';
+            *out++ = 't';
+            return out;
+        case 0x85:
+        case 0x2028:
+        case 0x2029:
+            return appendHex(out, 'u', c, 4);
+        default:
+            break;
+    }
+
+    if (c < 0x20 || c == 0x7F)
+        return appendHex(out, 'x', c, 2);
+
+    return nullptr;
+}
+
+}  // namespace
+
+namespace QLogger
+{
+
+qsizetype QLoggerUtf8::maxSize(qsizetype size, bool escape)
+{
+    // A UTF-16 code unit takes up to 3 bytes, or 6 when it is escaped as \uHHHH
+    return size * (escape ? 6 : 3);
+}
+
+char *QLoggerUtf8::encode(char *out, QStringView text, bool escape)
+{
+    const auto data = text.utf16();
+    const auto size = text.size();
+
+    qsizetype i = 0;
+
+    while (i < size)
+    {
+        const auto ascii = narrowAscii(out, data + i, size - i, escape);
+
+        out += ascii;
+        i += ascii;
+
+        // The block that stopped the fast path, or the tail of the text, goes through the scalar encoder
+        const auto end = std::min(size, i + BLOCK);
+
+        while (i < end)
+        {
+            const auto c = data[i++];
+
+            if (escape)
+            {
+                if (const auto escaped = appendEscaped(out, c))
+                {
+                    out = escaped;
+                    continue;
+                }
+            }
+
+            if (c < 0x80)
+                *out++ = static_cast<char>(c);
+            else if (c < 0x800)
+            {
+                *out++ = static_cast<char>(0xC0 | (c >> 6));
+                *out++ = static_cast<char>(0x80 | (c & 0x3F));
+            }
+            else if (QChar::isHighSurrogate(c) && i < size && QChar::isLowSurrogate(data[i]))
+            {
+                const auto ucs4 = QChar::surrogateToUcs4(c, data[i++]);
+
+                *out++ = static_cast<char>(0xF0 | (ucs4 >> 18));
+                *out++ = static_cast<char>(0x80 | ((ucs4 >> 12) & 0x3F));
+                *out++ = static_cast<char>(0x80 | ((ucs4 >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (ucs4 & 0x3F));
+            }
+            else
+            {
+                // Unpaired surrogates become the replacement character
+                const auto ucs2 = QChar::isSurrogate(c) ? static_cast<char16_t>(0xFFFD) : c;
+
+                *out++ = static_cast<char>(0xE0 | (ucs2 >> 12));
+                *out++ = static_cast<char>(0x80 | ((ucs2 >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (ucs2 & 0x3F));
+            }
+        }
+    }
+
+    return out;
+}
+
+void QLoggerUtf8::append(QByteArray &out, QStringView text, bool escape)
+{
+    const auto size = out.size();
+
+    out.resize(size + maxSize(text.size(), escape));
+
+    const auto end = encode(out.data() + size, text, escape);
+
+    out.truncate(end - out.constData());
+}
+
+}  // namespace QLogger
@@ -0,0 +1,64 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QByteArray>
+#include <QStringView>
+
+namespace QLogger
+{
+
+/**
+ * @brief The QLoggerUtf8 class encodes the text lines of the files in UTF-8. Log lines are mostly ASCII, so blocks
+ * of 16 characters that are all ASCII are narrowed with SIMD instructions (SSE2 or NEON when the compiler targets
+ * them) and only the other characters go through the scalar encoder. It can also escape the control characters, so a
+ * message with new lines stays on one line of the file.
+ */
+class QLoggerUtf8
+{
+public:
+    /**
+    * @brief maxSize Gets the maximum number of bytes of an encoded text.
+    * @param size The size of the text in UTF-16 code units.
+    * @param escape If the control characters are escaped.
+    */
+    static qsizetype maxSize(qsizetype size, bool escape);
+
+    /**
+    * @brief encode Encodes a text in UTF-8. Unpaired surrogates are replaced by U+FFFD, as QStringEncoder does.
+    * @param out The destination, with at least maxSize(text.size(), escape) bytes.
+    * @param text The text.
+    * @param escape If the control characters are escaped: new lines, carriage returns and tabs become \n, \r and \t,
+    * the other C0 characters and DEL become \xHH and the Unicode line separators become \uHHHH. The backslashes are
+    * written as they are.
+    * @return The end of the encoded text.
+    */
+    static char *encode(char *out, QStringView text, bool escape = false);
+
+    /**
+    * @brief append Encodes a text in UTF-8 at the end of a buffer.
+    */
+    static void append(QByteArray &out, QStringView text, bool escape = false);
+};
+
+}  // namespace QLogger
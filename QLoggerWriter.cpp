@@ -1,13 +1,25 @@
 #include "QLoggerWriter.h"
 
+#include "QLogger.h"
+#include "QLoggerCompressor.h"
+#include "QLoggerConsole.h"
+#include "QLoggerThread.h"
+#include "QLoggerWriterPool.h"
+
 #include <QAbstractEventDispatcher>
 #include <QDateTime>
+#include <QDeadlineTimer>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QFutureWatcher>
-#include <QProcess>
-#include <QTextStream>
+
+#ifdef Q_OS_WIN
+#    include <io.h>
+#    include <windows.h>
+#else
+#    include <unistd.h>
+#endif
 
 namespace
 {
@@ -21,58 +33,246 @@ QString levelToText(const QLogger::LogLevel &level)
     switch (level)
     {
     case QLogger::LogLevel::Trace:
-        return "Trace";
+        return QStringLiteral("Trace");
     case QLogger::LogLevel::Debug:
-        return "Debug";
+        return QStringLiteral("Debug");
     case QLogger::LogLevel::Info:
-        return "Info";
+        return QStringLiteral("Info");
     case QLogger::LogLevel::Warning:
-        return "Warning";
+        return QStringLiteral("Warning");
     case QLogger::LogLevel::Error:
-        return "Error";
+        return QStringLiteral("Error");
     case QLogger::LogLevel::Fatal:
-        return "Fatal";
+        return QStringLiteral("Fatal");
     }
 
     return QString();
 }
-}  // namespace
 
-namespace QLogger
+/**
+ * @brief Gets the memory used by a record in the queue.
+ */
+qint64 recordSize(const QLogger::LogRecord &record)
+{
+    return static_cast<qint64>(sizeof(QLogger::LogRecord) + record.message.size() * sizeof(QChar)
+                               + record.fields.size() * sizeof(QLogger::LogField));
+}
+
+/**
+ * @brief Appends a positive number in decimal without a temporary string.
+ */
+void appendNumber(QString &out, int number)
 {
+    char digits[12];
+    auto length = 0;
+
+    do
+    {
+        digits[length++] = static_cast<char>('0' + number % 10);
+        number /= 10;
+    } while (number > 0);
 
-QMutex QLoggerWriter::zipLock;
-QMutex QLoggerWriter::writeLock;
+    while (length > 0)
+        out.append(QLatin1Char(digits[--length]));
+}
 
-QLoggerWriter::QLoggerWriter(const QString &fileDestination, LogLevel level, const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions)
-    : mFileSuffixIfFull(fileSuffixIfFull)
-    , mMode(mode)
-    , mLevel(level)
-    , mMessageOptions(messageOptions)
+/**
+ * @brief Appends a text as a JSON string, with the quotes.
+ */
+void appendJsonString(QString &out, const QString &text)
 {
-    mFileDestinationFolder = fileFolderDestination.isEmpty() ? QDir::currentPath() + "/logs/" : fileFolderDestination;
+    out.append(QLatin1Char('"'));
 
-    if (!mFileDestinationFolder.endsWith("/"))
-        mFileDestinationFolder.append("/");
+    for (const auto c : text)
+    {
+        switch (c.unicode())
+        {
+            case '"':
+                out.append(QLatin1String("\\\""));
+                break;
+            case '\\':
+                out.append(QLatin1String("\\\\"));
+                break;
+            case '\n':
+                out.append(QLatin1String("\\n"));
+                break;
+            case '\r':
+                out.append(QLatin1String("\\r"));
+                break;
+            case '\t':
+                out.append(QLatin1String("\\t"));
+                break;
+            default:
+                if (c.unicode() < 0x20)
+                    out.append(QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0')));
+                else
+                    out.append(c);
+        }
+    }
 
-    mFileDestination = mFileDestinationFolder + fileDestination;
+    out.append(QLatin1Char('"'));
+}
 
-    QDir dir(mFileDestinationFolder);
-    if (fileDestination.isEmpty())
+/**
+ * @brief Appends a value as JSON: numbers and booleans as they are, the other types as strings.
+ */
+void appendJsonValue(QString &out, const QVariant &value)
+{
+    switch (value.metaType().id())
     {
-        mFileDestination = dir.filePath(QString::fromLatin1("%1.log").arg(
-            QDateTime::currentDateTime().date().toString(QString::fromLatin1("yyyy-MM-dd"))));
+        case QMetaType::Bool:
+            out.append(value.toBool() ? QLatin1String("true") : QLatin1String("false"));
+            break;
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::Long:
+        case QMetaType::ULong:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Short:
+        case QMetaType::UShort:
+            out.append(value.toString());
+            break;
+        case QMetaType::Double:
+        case QMetaType::Float:
+            if (qIsFinite(value.toDouble()))
+            {
+                out.append(value.toString());
+                break;
+            }
+            [[fallthrough]];
+        default:
+            appendJsonString(out, value.toString());
     }
-    else if (!fileDestination.contains(QLatin1Char('.')))
-        mFileDestination.append(QString::fromLatin1(".log"));
+}
 
-    if (mMode == LogMode::Full || mMode == LogMode::OnlyFile)
-        dir.mkpath(QStringLiteral("."));
+/**
+ * @brief Appends a line as a JSON object with the elements of the options and the fields.
+ */
+void appendJson(QString &text, QLogger::LogMessageDisplays messageOptions, QLogger::LogLevel threshold, const QString &date, const QString &threadId, const QString &module, QLogger::LogLevel level, const QString &function, const QString &fileName, int line, const QString &message, const QLogger::LogFields &fields)
+{
+    using QLogger::LogMessageDisplay;
 
-    //QLogger commit
+    text.append(QLatin1Char('{'));
+
+    const auto start = text.size();
+
+    const auto appendKey = [&text, start](QLatin1String key) {
+        if (text.size() > start)
+            text.append(QLatin1Char(','));
+
+        text.append(QLatin1Char('"'));
+        text.append(key);
+        text.append(QLatin1String("\":"));
+    };
+
+    if (messageOptions.testFlag(LogMessageDisplay::DateTime))
+    {
+        appendKey(QLatin1String("time"));
+        appendJsonString(text, date);
+    }
+
+    if (messageOptions.testFlag(LogMessageDisplay::LogLevel))
+    {
+        appendKey(QLatin1String("level"));
+        appendJsonString(text, levelToText(level));
+    }
+
+    if (messageOptions.testFlag(LogMessageDisplay::ModuleName))
+    {
+        appendKey(QLatin1String("module"));
+        appendJsonString(text, module);
+    }
+
+    if (messageOptions.testFlag(LogMessageDisplay::ThreadId))
+    {
+        appendKey(QLatin1String("thread"));
+        appendJsonString(text, threadId);
+    }
+
+    // As in the text lines, the origin of the message is only displayed up to the debug level
+    if (threshold <= QLogger::LogLevel::Debug)
+    {
+        if (messageOptions.testFlag(LogMessageDisplay::File) && !fileName.isEmpty())
+        {
+            appendKey(QLatin1String("file"));
+            appendJsonString(text, fileName);
+        }
+
+        if (messageOptions.testFlag(LogMessageDisplay::Line) && line > 0)
+        {
+            appendKey(QLatin1String("line"));
+            appendNumber(text, line);
+        }
+
+        if (messageOptions.testFlag(LogMessageDisplay::Function) && !function.isEmpty())
+        {
+            appendKey(QLatin1String("function"));
+            appendJsonString(text, function);
+        }
+    }
+
+    if (messageOptions.testFlag(LogMessageDisplay::Message))
+    {
+        appendKey(QLatin1String("message"));
+        appendJsonString(text, message);
+    }
+
+    for (const auto &field : fields)
     {
-        wakeUpTime.start();
+        if (text.size() > start)
+            text.append(QLatin1Char(','));
 
+        appendJsonString(text, QString::fromUtf8(field.key));
+        text.append(QLatin1Char(':'));
+        appendJsonValue(text, field.value);
+    }
+
+    text.append(QLatin1String("}\n"));
+}
+
+/**
+ * @brief Writes the data of the file to the disk.
+ */
+void syncFile(QFile &file)
+{
+    const auto fd = file.handle();
+
+    if (fd < 0)
+        return;
+
+#if defined(Q_OS_WIN)
+    FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(fd)));
+#elif defined(Q_OS_DARWIN)
+    fsync(fd);
+#else
+    fdatasync(fd);
+#endif
+}
+}  // namespace
+
+namespace QLogger
+{
+
+QLoggerWriter::QLoggerWriter(const QString &fileDestination, LogLevel level, const QString &fileFolderDestination, LogMode mode, LogFileDisplay fileSuffixIfFull, LogMessageDisplays messageOptions)
+    : mFileSuffixIfFull(fileSuffixIfFull)
+    , mEnabledLevel(DISABLED_LEVEL)
+    , mMessages(std::make_unique<QLoggerQueue<LogRecord>>(mQueueCapacity))
+{
+    Config config;
+    config.level          = level;
+    config.mode           = mode;
+    config.messageOptions = messageOptions;
+    publishConfig(config);
+
+    mFileDestinationFolder = destinationFolder(fileFolderDestination);
+    mFileDestination       = destinationPath(fileDestination, fileFolderDestination);
+
+    if (mode == LogMode::Full || mode == LogMode::OnlyFile || mode == LogMode::MemoryMapped)
+        QDir(mFileDestinationFolder).mkpath(QStringLiteral("."));
+
+    //QLogger commit
+    {
         QFileInfo info(mFileDestination);
 
         if (info.exists())
@@ -86,45 +286,113 @@ QLoggerWriter::QLoggerWriter(const QString &fileDestination, LogLevel level, con
     }
 }
 
+QString QLoggerWriter::destinationPath(const QString &fileDestination, const QString &fileFolderDestination)
+{
+    const auto folder = destinationFolder(fileFolderDestination);
+
+    if (fileDestination.isEmpty())
+    {
+        return QDir(folder).filePath(QString::fromLatin1("%1.log").arg(
+            QDateTime::currentDateTime().date().toString(QString::fromLatin1("yyyy-MM-dd"))));
+    }
+
+    if (!fileDestination.contains(QLatin1Char('.')))
+        return folder + fileDestination + QString::fromLatin1(".log");
+
+    return folder + fileDestination;
+}
+
+QString QLoggerWriter::destinationFolder(const QString &fileFolderDestination)
+{
+    auto folder = fileFolderDestination.isEmpty() ? QDir::currentPath() + "/logs/" : fileFolderDestination;
+
+    if (!folder.endsWith("/"))
+        folder.append("/");
+
+    return folder;
+}
+
 void QLoggerWriter::setLogMode(LogMode mode)
 {
-    mMode = mode;
+    applyMode(mode);
+
+    QLoggerManager::getInstance()->updateMinimumLevel();
+}
+
+void QLoggerWriter::applyMode(LogMode mode)
+{
+    updateConfig([mode](Config &config) { config.mode = mode; });
 
-    if (mMode == LogMode::Full || mMode == LogMode::OnlyFile)
+    if (mode == LogMode::Full || mode == LogMode::OnlyFile || mode == LogMode::MemoryMapped)
     {
         QDir dir(mFileDestinationFolder);
         dir.mkpath(QStringLiteral("."));
     }
 
-    if (mode != LogMode::Disabled && !this->isRunning())
+    if (mode != LogMode::Disabled && !isActive())
         start();
 }
 
-QString QLoggerWriter::renameFileIfFull()
+void QLoggerWriter::setLogLevel(LogLevel level)
 {
-    if (currentDate == QDateTime::currentDateTime().date())
-        return QString();
+    applyLevel(level);
+
+    QLoggerManager::getInstance()->writerLevelChanged(this);
+}
+
+void QLoggerWriter::applyLevel(LogLevel level)
+{
+    updateConfig([level](Config &config) { config.level = level; });
+}
+
+void QLoggerWriter::stop(bool stop)
+{
+    applyStop(stop);
+
+    QLoggerManager::getInstance()->updateMinimumLevel();
+}
+
+void QLoggerWriter::applyStop(bool stop)
+{
+    updateConfig([stop](Config &config) { config.stop = stop; });
+}
+
+void QLoggerWriter::publishConfig(const Config &config)
+{
+    mConfig.publish(std::make_unique<const Config>(config));
+
+    const auto enabled = config.mode != LogMode::Disabled && !config.stop;
 
-    QFile file(mFileDestination);
+    mEnabledLevel.store(enabled ? static_cast<int>(config.level) : DISABLED_LEVEL, std::memory_order_relaxed);
+}
+
+QString QLoggerWriter::renameFileIfFull()
+{
+    const auto today = mTimestamps.date(QLoggerClock::currentMSecsSinceEpoch());
 
-    {  //QLogger commit
-        QString newName = mFileDestination;
-        newName.insert(newName.size() - 4, currentDate.toString("_yyyy_MM_dd"));
+    if (currentDate != today)
+    {
+        const auto dot       = mFileDestination.lastIndexOf('.');
+        const auto dated     = mFileDestination.left(dot) + currentDate.toString("_yyyy_MM_dd");
+        const auto extension = mFileDestination.mid(dot);
+        auto newName         = dated + extension;
 
-        if (!file.rename(mFileDestination, newName))  // не удалось переименовать
-            return QString();
+        // The file of that day already exists, i.e. after a restart on the same day: the next number is appended
+        for (auto number = 2; QFile::exists(newName) || QFile::exists(newName + ".gz"); ++number)
+            newName = QString("%1(%2)%3").arg(dated, QString::number(number), extension);
 
-        currentDate = QDateTime::currentDateTime().date();
+        const auto renamed = rotateFile(newName);
 
-        if (mQuit)  // if quit no zip
-            return newName;
+        // If the file can't be renamed, the logs of the new day continue in the same file
+        currentDate = today;
 
-        return zipFileCustom(newName);
+        return renamed;
     }
 
-    //--------
+    const auto maxFileSize = mMaxFileSize.load(std::memory_order_relaxed);
+
     // Rename file if it's full
-    if (file.size() >= mMaxFileSize)
+    if (maxFileSize > 0 && openFile() && mFileSize >= maxFileSize)
     {
         QString newName;
 
@@ -140,232 +408,1005 @@ QString QLoggerWriter::renameFileIfFull()
         else
             newName = generateDuplicateFilename(fileDestination, fileExtension);
 
-        const auto renamed = file.rename(mFileDestination, newName);
-
-        return renamed ? newName : QString();
+        return rotateFile(newName);
     }
 
     return QString();
 }
 
-QString QLoggerWriter::generateDuplicateFilename(const QString &fileDestination, const QString &fileExtension, int fileSuffixNumber)
+QString QLoggerWriter::rotateFile(const QString &newName)
 {
-    QString path(fileDestination);
-    if (fileSuffixNumber > 1)
-        path = QString("%1(%2).%3").arg(fileDestination, QString::number(fileSuffixNumber), fileExtension);
-    else
-        path.append(QString(".%1").arg(fileExtension));
+    // The file is opened again on the next write, with the new name if the rename succeeds
+    mFile.close();
 
-    // A name already exists, increment the number and check again
-    if (QFileInfo::exists(path))
-        return generateDuplicateFilename(fileDestination, fileExtension, fileSuffixNumber + 1);
+    if (!QFile::rename(mFileDestination, newName))  // не удалось переименовать
+        return QString();
 
-    // No file exists at the given location, so no need to continue
-    return path;
-}
+    const auto compress = !mQuit && mCompression != LogCompression::None;  // if quit no zip
 
-void QLoggerWriter::write(const QVector<QString> &messages)
-{
-    // Write data to console
-    if (mMode == LogMode::OnlyConsole)
+    const auto retained = config()->retention.isEnabled();
+
+    if (retained)
     {
-        for (const auto &message : messages)
-            qInfo() << message;
+        QStringList paths { newName };
 
-        return;
+        if (compress)
+            paths.append(QLoggerCompressor::archiveName(newName, mCompression));
+
+        QLoggerRetention::getInstance()->track(mFileDestination, paths, compress);
+    }
+
+    // The writer continues in the new file while the old one is compressed in the background
+    if (compress)
+    {
+        const auto done = [newName, retained]() {
+            if (retained)
+                QLoggerRetention::getInstance()->compressed(newName);
+        };
+
+        // A file left uncompressed is counted with its size now
+        if (!QLoggerCompressor::getInstance()->compress(newName, mCompression, mCompressionLevel, done))
+            done();
     }
 
-    // Write data to file
-    QFile file(mFileDestination);
+    return newName;
+}
 
-    const auto prevFilename = renameFileIfFull();
+void QLoggerWriter::setRetention(const LogRetention &retention)
+{
+    updateConfig([&retention](Config &config) { config.retention = retention; });
 
-    QMutexLocker write(&writeLock);
+    QLoggerRetention::getInstance()->setPolicy(mFileDestination, retention);
+}
 
-    if (file.open(QIODevice::ReadWrite | QIODevice::Text | QIODevice::Append))
+QString QLoggerWriter::generateDuplicateFilename(const QString &fileDestination, const QString &fileExtension)
+{
+    if (mNextFileNumber == 0)
     {
-        QTextStream out(&file);
+        const QFileInfo info(fileDestination);
+        const auto prefix = info.fileName() + '(';
+
+        // The first duplicate is number 2. The compressed files are taken into account too.
+        mNextFileNumber = 2;
 
-        if (!prevFilename.isEmpty())
-            out << QString("Previous log %1\n").arg(prevFilename);
+        const auto entries = info.dir().entryList({ prefix + '*' }, QDir::Files);
 
-        for (const auto &message : messages)
+        for (const auto &entry : entries)
         {
-            out << message;
+            const auto end = entry.indexOf(')', prefix.size());
+            auto ok        = false;
+            const auto number = entry.mid(prefix.size(), end - prefix.size()).toInt(&ok);
 
-            if (mMode == LogMode::Full)
-                qInfo() << message;
+            if (end > 0 && ok && number >= mNextFileNumber)
+                mNextFileNumber = number + 1;
         }
-
-        file.close();
     }
+
+    return QString("%1(%2).%3").arg(fileDestination, QString::number(mNextFileNumber++), fileExtension);
 }
 
-void QLoggerWriter::enqueue(const QDateTime &date, const QString &threadId, const QString &module, LogLevel level, const QString &function, const QString &fileName, int line, const QString &message)
+void QLoggerWriter::write(const QVector<LogRecord> &records)
 {
-    QMutexLocker locker(&mutex);
+    const auto mode = getMode();
 
-    if (mMode == LogMode::Disabled)
-        return;
-
-    QString fileLine;
-    if (mMessageOptions.testFlag(LogMessageDisplay::File) && mMessageOptions.testFlag(LogMessageDisplay::Line)
-        && !fileName.isEmpty() && line > 0 && mLevel <= LogLevel::Debug)
-    {
-        fileLine = QString("{%1:%2}").arg(fileName, QString::number(line));
-    }
-    else if (mMessageOptions.testFlag(LogMessageDisplay::File) && mMessageOptions.testFlag(LogMessageDisplay::Function)
-             && !fileName.isEmpty() && !function.isEmpty() && mLevel <= LogLevel::Debug)
+    if (mode == LogMode::MemoryMapped)
     {
-        fileLine = QString("{%1}{%2}").arg(fileName, function);
+        if (const auto ring = this->ring())
+        {
+            for (const auto &record : records)
+                ring->append(record);
+        }
+
+        return;
     }
 
-    QString text;
-    if (mMessageOptions.testFlag(LogMessageDisplay::Default))
+    QMutexLocker locker(&mFileMutex);
+
+    for (const auto &sink : qAsConst(mSinks))
+        sink->write(*this, records);
+
+    // The console buffers keep their capacity between batches
+    mConsoleOutput.truncate(0);
+    mConsoleError.truncate(0);
+
+    if (mode == LogMode::OnlyConsole)
     {
-        text = QString("[%1][%2][%3][%4]%5 %6")
-                   .arg(levelToText(level), module, date.toString("yyyy-MM-dd hh:mm:ss:zzz"), threadId, fileLine, message);
+        for (const auto &record : records)
+            appendConsole(record);
+
+        QLoggerConsole::getInstance()->write(mConsoleOutput, mConsoleError);
+
+        return;
     }
-    else
+
+    const auto prevFilename = renameFileIfFull();
+
+    // A binary file starts a new segment, with its own strings, every time it is opened
+    if (!mFile.isOpen())
+        mBinary.reset();
+
+    // The buffer keeps its capacity between batches
+    mBuffer.truncate(0);
+
+    if (!prevFilename.isEmpty())
     {
-        if (mMessageOptions.testFlag(LogMessageDisplay::LogLevel))
-            text.append(QString("[%1]").arg(levelToText(level)));
+        const auto previous = QString("Previous log %1\n").arg(prevFilename);
 
-        if (mMessageOptions.testFlag(LogMessageDisplay::ModuleName))
-            text.append(QString("[%1]").arg(module));
+        if (config()->format == LogFormat::Binary)
+            mBinary.appendLine(mBuffer, QLoggerClock::currentMSecsSinceEpoch(), previous);
+        else
+            appendText(mBuffer, previous);
+    }
 
-        if (mMessageOptions.testFlag(LogMessageDisplay::DateTime))
-            text.append(QString("[%1]").arg(date.toString("yyyy-MM-dd hh:mm:ss:zzz")));
+    for (const auto &record : records)
+        appendRecord(record, mode);
 
-        if (mMessageOptions.testFlag(LogMessageDisplay::ThreadId))
-            text.append(QString("[%1]").arg(threadId));
+    if (!mBuffer.isEmpty() && openFile())
+    {
+        const auto written = mFile.write(mBuffer);
 
-        if (!fileLine.isEmpty())
+        if (written > 0)
         {
-            if (fileLine.startsWith(QChar::Space))
-                fileLine = fileLine.right(1);
-
-            text.append(fileLine);
+            mFileSize += written;
+            mBytesWritten.fetch_add(written, std::memory_order_relaxed);
         }
-        if (mMessageOptions.testFlag(LogMessageDisplay::Message))
+
+        const auto now          = QLoggerClock::now();
+        const auto syncInterval = config()->syncInterval;
+
+        if (syncInterval == 0 || (syncInterval > 0 && now - mLastSync >= syncInterval * qint64(1000000))
+            || (syncInterval > 0 && mSyncWriteThrough))
         {
-            if (text.isEmpty() || text.endsWith(QChar::Space))
-                text.append(QString("%1").arg(message));
-            else
-                text.append(QString(" %1").arg(message));
+            syncDestination();
+            mLastSync = now;
         }
     }
 
-    text.append(QString::fromLatin1("\n"));
+    if (mode == LogMode::Full)
+        QLoggerConsole::getInstance()->write(mConsoleOutput, mConsoleError);
+
+    mSyncWriteThrough = false;
+}
 
-    mMessages.append(text);
+void QLoggerWriter::write(const QVector<QString> &messages)
+{
+    QVector<LogRecord> records;
+    records.reserve(messages.size());
 
-    if (wakeUpTime.elapsed() > writeMSec)
+    for (const auto &message : messages)
     {
-        if (!mIsStop)
-            mQueueNotEmpty.wakeAll();
+        LogRecord record;
+        record.timestamp = QLoggerClock::now();
+        record.message   = message;
 
-        wakeUpTime.start();
+        records.append(std::move(record));
     }
+
+    write(records);
 }
 
-void QLoggerWriter::run()
+void QLoggerWriter::appendRecord(const LogRecord &record, LogMode mode)
 {
-    if (!mQuit)
+    if (config()->format == LogFormat::Text)
     {
-        QMutexLocker locker(&mutex);
-        mQueueNotEmpty.wait(&mutex);
+        const auto start = mBuffer.size();
+
+        mLine.truncate(0);
+        formatRecord(mLine, record);
+        appendText(mBuffer, mLine);
+
+        // The console gets the line already encoded for the file
+        if (mode == LogMode::Full)
+            QLoggerConsole::getInstance()->appendLine(consoleBuffer(record.level), record.level,
+                                                     mBuffer.constData() + start, mBuffer.size() - start);
+
+        return;
     }
 
-    while (!mQuit)
-    {
-        decltype(mMessages) copy;
+    const auto msecs = QLoggerClock::toMSecsSinceEpoch(record.timestamp);
 
-        {
-            QMutexLocker locker(&mutex);
-            std::swap(copy, mMessages);
-        }
+    if (record.module)
+        mBinary.append(mBuffer, record, msecs, threadName(record.threadId));
+    else
+        mBinary.appendLine(mBuffer, msecs, record.message);
+
+    // The console always gets the text
+    if (mode == LogMode::Full)
+        appendConsole(record);
+}
 
-        write(copy);
+void QLoggerWriter::appendConsole(const LogRecord &record)
+{
+    mLine.truncate(0);
+    formatRecord(mLine, record);
 
-        lastActive = QDateTime::currentDateTime();
+    mConsoleLine.truncate(0);
+    appendText(mConsoleLine, mLine);
 
-        if (!mQuit)
-        {
-            QMutexLocker locker(&mutex);
-            mQueueNotEmpty.wait(&mutex);
-        }
-    }
+    QLoggerConsole::getInstance()->appendLine(consoleBuffer(record.level), record.level, mConsoleLine.constData(),
+                                              mConsoleLine.size());
 }
 
-void QLoggerWriter::closeDestination()
+QByteArray &QLoggerWriter::consoleBuffer(LogLevel level)
 {
-    QMutexLocker locker(&mutex);
+    return QLoggerConsole::isError(level) ? mConsoleError : mConsoleOutput;
+}
 
-    if (!mMessages.isEmpty())
-    {
-        decltype(mMessages) copy;
+QLoggerRing *QLoggerWriter::ring()
+{
+    std::call_once(mRingOnce, [this]() {
+        const auto path = mFileDestination.left(mFileDestination.lastIndexOf('.')) + QStringLiteral(".ring");
 
-        {
-            std::swap(copy, mMessages);
-        }
+        mRing = std::make_unique<QLoggerRing>(path, mRingSize);
+    });
 
-        write(copy);
-    }
+    return mRing->isOpen() ? mRing.get() : nullptr;
+}
 
-    QVector<QString> closed(0);
-    closed.append(QString("Closed %1 \n").arg(QDateTime::currentDateTime().toString()));
-    write(closed);
+void QLoggerWriter::appendText(QByteArray &out, const QString &text)
+{
+    const auto escape = config()->escape;
 
-    mQuit = true;
-    mQueueNotEmpty.wakeAll();
+    // The new line that ends the line is kept
+    if (escape && text.endsWith(QLatin1Char('\n')))
+    {
+        QLoggerUtf8::append(out, QStringView(text.constData(), text.size() - 1), true);
+        out.append('\n');
+    }
+    else
+        QLoggerUtf8::append(out, text, escape);
 }
 
-void QLoggerWriter::forcePush()
+bool QLoggerWriter::openFile()
 {
-    if (mMessages.count() > 0)
+    if (!mFile.isOpen())
     {
-        auto r = lastActive.secsTo(QDateTime::currentDateTime());
+        mFile.setFileName(mFileDestination);
 
-        if (r > 5)
-            mQueueNotEmpty.wakeAll();
+        // A binary file is written as it is: in text mode every 0x0A byte would become \r\n on Windows
+        auto openMode = QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered;
+
+        if (config()->format != LogFormat::Binary)
+            openMode |= QIODevice::Text;
+
+        // The size is only read from the file when it is opened, then the writer keeps track of it
+        if (mFile.open(openMode))
+            mFileSize = mFile.size();
     }
+
+    return mFile.isOpen();
+}
+
+void QLoggerWriter::closeFile()
+{
+    QMutexLocker locker(&mFileMutex);
+
+    mFile.close();
+}
+
+void QLoggerWriter::enqueue(const QDateTime &date, const QString &threadId, const QString &module, LogLevel level, const QString &function, const QString &fileName, int line, const QString &message)
+{
+    if (getMode() == LogMode::Disabled)
+        return;
+
+    LogRecord record;
+    record.timestamp = QLoggerClock::now();
+    record.level     = level;
+    record.message   = formatMessage(date.toString("yyyy-MM-dd hh:mm:ss:zzz"), threadId, module, level, function, fileName, line, message);
+
+    enqueue(std::move(record));
 }
 
-QString QLoggerWriter::zipFileCustom(const QString &path)
+void QLoggerWriter::enqueue(LogRecord &&record)
 {
-    QMutexLocker zipLock1(&zipLock);
+    // The settings are copied once, the producer may wait for room below
+    const Config config = *this->config();
+
+    if (config.mode == LogMode::Disabled)
+        return;
+
+    // The record is copied in the mapped file right away, and written to the disk at the flush level
+    if (config.mode == LogMode::MemoryMapped)
+    {
+        if (const auto ring = this->ring())
+        {
+            ring->append(record);
+
+            if (record.level >= config.flushLevel)
+                ring->sync();
+        }
 
-    QElapsedTimer time;
-    time.start();
+        return;
+    }
 
-    // cut .log, add .7z
-    QString archiveName = path.mid(0, path.size() - 4) + ".7z";
+    // The destination is being closed: nothing writes the queue anymore
+    if (mClosing.load(std::memory_order_acquire))
+        return;
 
-    QStringList param;
-    param << "a"
-          << "-t7z"
-          << "-mx9"
-          << archiveName << path;
+    const auto size = recordSize(record);
 
-    QProcess zip;
+    if (!makeRoom(size, config))
+        return;
 
-    QString pathExe = "7z";
-    zip.start(pathExe, param);
+    mQueuedBytes.fetch_add(size, std::memory_order_relaxed);
 
-    bool res = zip.waitForFinished(1000 * 60 * 15);  // 15 min
+    // Two clock reads per message would cost more than the rest of the call: one message in 256 is timed
+    static thread_local quint32 enqueueCount = 0;
+    const auto start = (++enqueueCount & 0xFF) == 0 ? QLoggerClock::now() : 0;
 
-    auto exitStatus = (bool)zip.exitStatus();
+    const auto writeThrough = record.level >= config.flushLevel;
+    quint64 position        = 0;
 
-    zip.close();
+    // Other producers took the room: the writer thread drains the queue while the producer waits for a free slot
+    while (!mMessages->tryPush(std::move(record), &position))
+    {
+        if (isStop() || mClosed.load(std::memory_order_acquire))
+        {
+            mQueuedBytes.fetch_sub(size, std::memory_order_relaxed);
+            mDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
 
-    QString result = QString("%1 to archive : %2. %3. Time::%4")
-                         .arg(path,
-                              archiveName,
-                              QString("finished: %1, %2").arg(res ? "yes" : "no", exitStatus ? "The process crashed" : "The process exited normall"),
-                              QString::number(time.elapsed()));
+        waitForRoom(size);
+    }
 
-    return result;
+    if (writeThrough)
+    {
+        wakeUp();
+        waitForWritten(position + 1);
+    }
+    else
+        notifyEnqueued();
+
+    if (start != 0)
+        mEnqueueLatency.record(static_cast<quint64>(QLoggerClock::now() - start) / 1000);
+}
+
+void QLoggerWriter::notifyEnqueued()
+{
+    // Pairs with the store of the state in waitForBatch: either the writer sees the new message or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    auto state = mWriterState.load(std::memory_order_relaxed);
+
+    if (state == WriterState::Idle && mWriterState.compare_exchange_strong(state, WriterState::Waiting))
+    {
+        if (mPool)
+        {
+            mPool->schedule(this, config()->flushLatency);
+            return;
+        }
+
+        QMutexLocker locker(&mutex);
+        mQueueNotEmpty.wakeAll();
+    }
+    else if (state == WriterState::Waiting && isBatchFull()
+             && mWriterState.compare_exchange_strong(state, WriterState::Busy))
+    {
+        wakeUp();
+    }
+}
+
+QString QLoggerWriter::formatRecord(const LogRecord &record)
+{
+    QString text;
+    formatRecord(text, record);
+
+    return text;
+}
+
+void QLoggerWriter::formatRecord(QString &text, const LogRecord &record)
+{
+    // Already formatted line
+    if (!record.module)
+    {
+        text.append(record.message);
+        return;
+    }
+
+    mDate.truncate(0);
+    mTimestamps.append(mDate, QLoggerClock::toMSecsSinceEpoch(record.timestamp));
+
+    const auto threadId = threadName(record.threadId);
+    const auto &names   = siteNames(record.site);
+    const auto config   = this->config();
+
+    appendLine(text, config->messageOptions, config->level, mDate, threadId, *record.module, record.level,
+               names.function, names.file, record.site->line, record.message, record.fields);
+}
+
+const QLoggerWriter::SiteNames &QLoggerWriter::siteNames(const LogCallSite *site)
+{
+    // The call sites are interned, so their names are only converted once per writer
+    auto iter = mSiteNames.find(site);
+
+    if (iter == mSiteNames.end())
+        iter = mSiteNames.insert(site, { QString::fromUtf8(site->function), QString::fromUtf8(site->file) });
+
+    return iter.value();
+}
+
+QString QLoggerWriter::threadName(quintptr threadId)
+{
+    const auto generation = QLoggerThread::generation();
+
+    // Threads come and go: the cache is also dropped when it gets too big
+    if (generation != mThreadNamesGeneration || mThreadNames.size() > 256)
+    {
+        mThreadNames.clear();
+        mThreadNamesGeneration = generation;
+    }
+
+    auto iter = mThreadNames.find(threadId);
+
+    if (iter == mThreadNames.end())
+        iter = mThreadNames.insert(threadId, QLoggerThread::displayName(threadId));
+
+    return iter.value();
+}
+
+QString QLoggerWriter::formatLine(LogMessageDisplays messageOptions, LogLevel threshold, const QString &date, const QString &threadId, const QString &module, LogLevel level, const QString &function, const QString &fileName, int line, const QString &message, const LogFields &fields)
+{
+    QString text;
+    appendLine(text, messageOptions, threshold, date, threadId, module, level, function, fileName, line, message, fields);
+
+    return text;
+}
+
+void QLoggerWriter::appendLine(QString &text, LogMessageDisplays messageOptions, LogLevel threshold, const QString &date, const QString &threadId, const QString &module, LogLevel level, const QString &function, const QString &fileName, int line, const QString &message, const LogFields &fields)
+{
+    if (messageOptions.testFlag(LogMessageDisplay::Json))
+    {
+        appendJson(text, messageOptions, threshold, date, threadId, module, level, function, fileName, line, message,
+                   fields);
+        return;
+    }
+
+    const auto appendBracket = [&text](const QString &value) {
+        text.append(QLatin1Char('['));
+        text.append(value);
+        text.append(QLatin1Char(']'));
+    };
+
+    // {file:line} or {file}{function}
+    const auto appendFileLine = [&]() {
+        if (messageOptions.testFlag(LogMessageDisplay::File) && messageOptions.testFlag(LogMessageDisplay::Line)
+            && !fileName.isEmpty() && line > 0 && threshold <= LogLevel::Debug)
+        {
+            text.append(QLatin1Char('{'));
+            text.append(fileName);
+            text.append(QLatin1Char(':'));
+            appendNumber(text, line);
+            text.append(QLatin1Char('}'));
+        }
+        else if (messageOptions.testFlag(LogMessageDisplay::File)
+                 && messageOptions.testFlag(LogMessageDisplay::Function) && !fileName.isEmpty()
+                 && !function.isEmpty() && threshold <= LogLevel::Debug)
+        {
+            text.append(QLatin1Char('{'));
+            text.append(fileName);
+            text.append(QLatin1String("}{"));
+            text.append(function);
+            text.append(QLatin1Char('}'));
+        }
+    };
+
+    const auto start = text.size();
+
+    if (messageOptions.testFlag(LogMessageDisplay::Default))
+    {
+        appendBracket(levelToText(level));
+        appendBracket(module);
+        appendBracket(date);
+        appendBracket(threadId);
+        appendFileLine();
+        text.append(QChar::Space);
+        text.append(message);
+    }
+    else
+    {
+        if (messageOptions.testFlag(LogMessageDisplay::LogLevel))
+            appendBracket(levelToText(level));
+
+        if (messageOptions.testFlag(LogMessageDisplay::ModuleName))
+            appendBracket(module);
+
+        if (messageOptions.testFlag(LogMessageDisplay::DateTime))
+            appendBracket(date);
+
+        if (messageOptions.testFlag(LogMessageDisplay::ThreadId))
+            appendBracket(threadId);
+
+        appendFileLine();
+
+        if (messageOptions.testFlag(LogMessageDisplay::Message))
+        {
+            if (text.size() > start && !text.endsWith(QChar::Space))
+                text.append(QChar::Space);
+
+            text.append(message);
+        }
+    }
+
+    appendFields(text, fields);
+
+    text.append(QLatin1Char('\n'));
+}
+
+QString QLoggerWriter::formatFields(const LogFields &fields)
+{
+    QString text;
+    appendFields(text, fields);
+
+    return text;
+}
+
+void QLoggerWriter::appendFields(QString &text, const LogFields &fields)
+{
+    for (const auto &field : fields)
+    {
+        const auto value = field.value.toString();
+
+        text.append(QChar::Space);
+        text.append(QString::fromUtf8(field.key));
+        text.append(QLatin1Char('='));
+
+        if (value.isEmpty() || value.contains(QChar::Space) || value.contains(QLatin1Char('"'))
+            || value.contains(QLatin1Char('=')))
+        {
+            appendJsonString(text, value);
+        }
+        else
+            text.append(value);
+    }
+}
+
+void QLoggerWriter::setQueueCapacity(int maxMessages, qint64 maxBytes)
+{
+    if (!isActive() && mMessages->isEmpty())
+    {
+        mMessages      = std::make_unique<QLoggerQueue<LogRecord>>(maxMessages);
+        mQueueCapacity = maxMessages;
+    }
+    else
+        mQueueCapacity = qMin(maxMessages, static_cast<int>(mMessages->capacity()));
+
+    mQueueMaxBytes = maxBytes;
+}
+
+void QLoggerWriter::setOverflowPolicy(LogOverflowPolicy policy, int sampleRate)
+{
+    updateConfig([policy, sampleRate](Config &config) {
+        config.overflowPolicy = policy;
+        config.sampleRate     = qMax(sampleRate, 1);
+    });
+}
+
+bool QLoggerWriter::isFull(qint64 size) const
+{
+    const auto queued = mMessages->size();
+
+    if (queued >= mQueueCapacity)
+        return true;
+
+    // A single message bigger than the limit is accepted when the queue is empty
+    return mQueueMaxBytes > 0 && queued > 0 && mQueuedBytes.load(std::memory_order_relaxed) + size > mQueueMaxBytes;
+}
+
+void QLoggerWriter::waitForRoom(qint64 size)
+{
+    wakeUp();
+
+    QMutexLocker locker(&mRoomMutex);
+
+    mBlockedProducers.fetch_add(1);
+
+    // Checked again under the lock, so the wake-up of takeMessages can't be missed. The wait is bounded anyway, so a
+    // producer never sleeps long on a queue that got room without a wake-up (a stop or a dropped record).
+    if (isFull(size))
+        mQueueNotFull.wait(&mRoomMutex, 10);
+
+    mBlockedProducers.fetch_sub(1);
+}
+
+void QLoggerWriter::dropOldest()
+{
+    LogRecord record;
+
+    if (mMessages->tryPop(record))
+    {
+        mQueuedBytes.fetch_sub(recordSize(record), std::memory_order_relaxed);
+        mDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool QLoggerWriter::makeRoom(qint64 size, const Config &config)
+{
+    while (isFull(size))
+    {
+        switch (config.overflowPolicy)
+        {
+            case LogOverflowPolicy::Block:
+                if (isStop() || mClosed.load(std::memory_order_acquire))
+                {
+                    mDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                waitForRoom(size);
+                break;
+            case LogOverflowPolicy::DropOldest:
+                dropOldest();
+                break;
+            case LogOverflowPolicy::DropNewest:
+                mDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            case LogOverflowPolicy::Sample:
+                if (mSampleCounter.fetch_add(1, std::memory_order_relaxed) % config.sampleRate != 0)
+                {
+                    mDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                dropOldest();
+                break;
+        }
+    }
+
+    return true;
+}
+
+void QLoggerWriter::wakeUp()
+{
+    if (isStop())
+        return;
+
+    if (mPool)
+    {
+        mFlushRequested.store(true, std::memory_order_relaxed);
+        mPool->schedule(this, 0);
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+    mFlushRequested.store(true, std::memory_order_relaxed);
+    mQueueNotEmpty.wakeAll();
+}
+
+bool QLoggerWriter::isBatchFull() const
+{
+    const auto config = this->config();
+
+    return (config->flushBatchMessages > 0 && mMessages->size() >= config->flushBatchMessages)
+        || (config->flushBatchBytes > 0 && mQueuedBytes.load(std::memory_order_relaxed) >= config->flushBatchBytes);
+}
+
+void QLoggerWriter::setFlushPolicy(int maxLatency, int batchMessages, qint64 batchBytes)
+{
+    updateConfig([maxLatency, batchMessages, batchBytes](Config &config) {
+        config.flushLatency       = qMax(maxLatency, 0);
+        config.flushBatchMessages = qMax(batchMessages, 0);
+        config.flushBatchBytes    = qMax(batchBytes, qint64(0));
+    });
+
+    QMutexLocker locker(&mutex);
+    mQueueNotEmpty.wakeAll();
+}
+
+void QLoggerWriter::waitForBatch()
+{
+    QMutexLocker locker(&mutex);
+
+    // Nothing to write: sleep until a producer enqueues the first message
+    while (!mQuit && !mClosing.load(std::memory_order_acquire) && mMessages->isEmpty())
+    {
+        mWriterState.store(WriterState::Idle);
+
+        if (mMessages->isEmpty())
+            mQueueNotEmpty.wait(&mutex);
+    }
+
+    // The deadline starts when the first message wakes the writer, so it is the age of the oldest message
+    const QDeadlineTimer deadline(config()->flushLatency);
+
+    mWriterState.store(WriterState::Waiting);
+
+    while (!mQuit && !mClosing.load(std::memory_order_acquire) && !deadline.hasExpired()
+           && !mFlushRequested.load(std::memory_order_relaxed) && !isBatchFull())
+        mQueueNotEmpty.wait(&mutex, deadline);
+
+    mWriterState.store(WriterState::Busy);
+    mFlushRequested.store(false, std::memory_order_relaxed);
+}
+
+bool QLoggerWriter::waitForWritten(quint64 position)
+{
+    QMutexLocker locker(&mutex);
+
+    while (mWrittenPosition.load(std::memory_order_acquire) < position)
+    {
+        if (mQuit || isStop() || !isActive())
+            return false;
+
+        // A message pushed while the writer was taking the batch waits for the next one
+        mFlushRequested.store(true, std::memory_order_relaxed);
+
+        if (mPool)
+            mPool->schedule(this, 0);
+        else
+            mQueueNotEmpty.wakeAll();
+
+        mBatchWritten.wait(&mutex, 100);
+    }
+
+    return true;
+}
+
+void QLoggerWriter::flush()
+{
+    // The ring has no queue, its pages are written to the disk
+    if (getMode() == LogMode::MemoryMapped)
+    {
+        if (const auto ring = this->ring())
+            ring->sync();
+
+        return;
+    }
+
+    waitForWritten(mMessages->enqueuePosition());
+
+    QMutexLocker locker(&mFileMutex);
+
+    if (mFile.isOpen())
+        syncDestination();
+}
+
+void QLoggerWriter::syncDestination()
+{
+    const auto start = QLoggerClock::now();
+
+    syncFile(mFile);
+
+    mSyncLatency.record(static_cast<quint64>(QLoggerClock::now() - start) / 1000);
+}
+
+void QLoggerWriter::setDurability(LogLevel flushLevel, int syncInterval)
+{
+    updateConfig([flushLevel, syncInterval](Config &config) {
+        config.flushLevel   = flushLevel;
+        config.syncInterval = syncInterval;
+    });
+}
+
+void QLoggerWriter::writeQueue()
+{
+    // The batch keeps its capacity between the calls, so the records are not reallocated once it has grown
+    takeRecords(mBatch);
+
+    // Every message before this position has been taken by the writer or dropped
+    const auto position = mMessages->dequeuePosition();
+    const auto start    = QLoggerClock::now();
+
+    write(mBatch);
+
+    mWrittenPosition.store(position, std::memory_order_release);
+
+    if (!mBatch.isEmpty())
+    {
+        mWriteLatency.record(static_cast<quint64>(QLoggerClock::now() - start) / 1000);
+        mBatchSize.record(mBatch.size());
+        mBatches.fetch_add(1, std::memory_order_relaxed);
+        mWrittenMessages.fetch_add(mBatch.size(), std::memory_order_relaxed);
+    }
+
+    mBatch.clear();
+
+    // The snapshots replaced while producers were reading them
+    if (mConfig.hasRetired())
+    {
+        QMutexLocker locker(&mConfigMutex);
+        mConfig.reclaim();
+    }
+}
+
+void QLoggerWriter::takeRecords(QVector<LogRecord> &records)
+{
+    const auto first = records.size();
+    records.reserve(first + mMessages->size() + 1);
+
+    LogRecord record;
+    const auto flushLevel = config()->flushLevel;
+
+    QLoggerClock::calibrate();
+
+    while (mMessages->tryPop(record))
+    {
+        mQueuedBytes.fetch_sub(recordSize(record), std::memory_order_relaxed);
+        mSyncWriteThrough = mSyncWriteThrough || record.level >= flushLevel;
+        records.append(std::move(record));
+    }
+
+    if (records.size() - first > mQueueHighWater.load(std::memory_order_relaxed))
+        mQueueHighWater.store(records.size() - first, std::memory_order_relaxed);
+
+    // The producers waiting for room can push again
+    if (mBlockedProducers.load() > 0)
+    {
+        QMutexLocker locker(&mRoomMutex);
+        mQueueNotFull.wakeAll();
+    }
+
+    if (const auto dropped = mDroppedMessages.exchange(0, std::memory_order_relaxed))
+    {
+        mDroppedTotal.fetch_add(dropped, std::memory_order_relaxed);
+
+        static const QString module = QStringLiteral("QLogger");
+
+        LogRecord summary;
+        summary.timestamp = QLoggerClock::now();
+        summary.threadId  = QLoggerThread::currentId();
+        summary.level     = LogLevel::Warning;
+        summary.module    = &module;
+        summary.message   = QString("%1 messages were discarded because the queue was full").arg(dropped);
+
+        records.append(std::move(summary));
+    }
+}
+
+void QLoggerWriter::run()
+{
+    while (!mQuit)
+    {
+        waitForBatch();
+
+        if (mClosing.load(std::memory_order_acquire))
+        {
+            drainAndClose();
+            break;
+        }
+
+        if (!mQuit)
+        {
+            writeQueue();
+
+            QMutexLocker locker(&mutex);
+            mBatchWritten.wakeAll();
+        }
+    }
+}
+
+void QLoggerWriter::setPool(QLoggerWriterPool *pool)
+{
+    mPool = pool;
+    mWriterState.store(WriterState::Idle);
+
+    pool->add(this);
+
+    // The messages enqueued before the writer was attached are scheduled like a new one
+    if (!mMessages->isEmpty())
+        notifyEnqueued();
+}
+
+void QLoggerWriter::writeBatch()
+{
+    mWriterState.store(WriterState::Busy);
+    mFlushRequested.store(false, std::memory_order_relaxed);
+
+    if (mClosing.load(std::memory_order_acquire))
+    {
+        // The destination is not scheduled again once closed
+        if (!mClosed.load(std::memory_order_acquire))
+            drainAndClose();
+
+        return;
+    }
+
+    if (!mQuit)
+        writeQueue();
+
+    {
+        QMutexLocker locker(&mutex);
+        mBatchWritten.wakeAll();
+    }
+
+    // Same handshake as notifyEnqueued: either the producer sees the writer idle or the message is seen here
+    mWriterState.store(WriterState::Idle);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    auto state = WriterState::Idle;
+
+    if (!mMessages->isEmpty() && mWriterState.compare_exchange_strong(state, WriterState::Waiting))
+        mPool->schedule(this, isBatchFull() ? 0 : config()->flushLatency);
+}
+
+void QLoggerWriter::closeDestination()
+{
+    mClosing.store(true, std::memory_order_release);
+
+    drainAndClose();
+}
+
+void QLoggerWriter::requestClose()
+{
+    mClosing.store(true, std::memory_order_release);
+
+    if (mPool)
+        mPool->schedule(this, 0);
+    else
+    {
+        QMutexLocker locker(&mutex);
+        mQueueNotEmpty.wakeAll();
+    }
+}
+
+bool QLoggerWriter::waitForClosed(QDeadlineTimer deadline)
+{
+    QMutexLocker locker(&mutex);
+
+    while (!mClosed.load(std::memory_order_acquire))
+    {
+        if (!mBatchWritten.wait(&mutex, deadline))
+            return mClosed.load(std::memory_order_acquire);
+    }
+
+    return true;
+}
+
+void QLoggerWriter::drainAndClose()
+{
+    // The mutex is not held while writing, so the threads that wait for the close can give up on time
+    while (!mMessages->isEmpty() && !mAbandoned.load(std::memory_order_acquire))
+        writeQueue();
+
+    LogRecord record;
+
+    while (mMessages->tryPop(record))
+        mDroppedTotal.fetch_add(1, std::memory_order_relaxed);
+
+    QVector<QString> closed(0);
+    closed.append(QString("Closed %1 \n").arg(QDateTime::currentDateTime().toString()));
+    write(closed);
+
+    closeFile();
+
+    QMutexLocker locker(&mutex);
+
+    mQuit = true;
+    mClosed.store(true, std::memory_order_release);
+    mQueueNotEmpty.wakeAll();
+    mBatchWritten.wakeAll();
+}
+
+void QLoggerWriter::addSink(std::shared_ptr<QLoggerSink> sink)
+{
+    QMutexLocker locker(&mFileMutex);
+
+    mSinks.append(std::move(sink));
+}
+
+LogWriterStats QLoggerWriter::stats() const
+{
+    LogWriterStats stats;
+    stats.fileDestination = mFileDestination;
+    stats.enqueued        = mMessages->enqueuePosition();
+    stats.written         = mWrittenMessages.load(std::memory_order_relaxed);
+    stats.dropped         = mDroppedTotal.load(std::memory_order_relaxed) + mDroppedMessages.load(std::memory_order_relaxed);
+    stats.bytesWritten    = mBytesWritten.load(std::memory_order_relaxed);
+    stats.batches         = mBatches.load(std::memory_order_relaxed);
+    stats.queueDepth      = mMessages->size();
+    stats.queueHighWater  = mQueueHighWater.load(std::memory_order_relaxed);
+    stats.batchSize       = mBatchSize.values();
+    stats.writeLatency    = mWriteLatency.values();
+    stats.syncLatency     = mSyncLatency.values();
+    stats.enqueueLatency  = mEnqueueLatency.values();
+
+    return stats;
+}
+
+void QLoggerWriter::forcePush()
+{
+    if (!mMessages->isEmpty())
+        wakeUp();
 }
 
 }  // namespace QLogger
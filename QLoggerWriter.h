@@ -23,20 +23,43 @@
  ***************************************************************************************/
 
 #include <QDateTime>
+#include <QDeadlineTimer>
+#include <QFile>
+#include <QHash>
+#include <QLoggerBinary.h>
+#include <QLoggerClock.h>
 #include <QLoggerLevel.h>
+#include <QLoggerQueue.h>
+#include <QLoggerRecord.h>
+#include <QLoggerRetention.h>
+#include <QLoggerRing.h>
+#include <QLoggerSink.h>
+#include <QLoggerSnapshot.h>
+#include <QLoggerStats.h>
+#include <QLoggerUtf8.h>
 #include <QMutex>
 #include <QThread>
 #include <QTimer>
 #include <QVector>
 #include <QWaitCondition>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace QLogger
 {
 
+class QLoggerWriterPool;
+
 class QLoggerWriter : public QThread
 {
     Q_OBJECT
 
+    friend class QLoggerManager;
+    friend class QLoggerWriterPool;
+
 public:
     /**
     * @brief Constructor that gets the complete path and filename to create the file. It also
@@ -49,6 +72,14 @@ public:
     */
     explicit QLoggerWriter(const QString &fileDestination, LogLevel level = LogLevel::Warning, const QString &fileFolderDestination = QString(), LogMode mode = LogMode::OnlyFile, LogFileDisplay fileSuffixIfFull = LogFileDisplay::DateTime, LogMessageDisplays messageOptions = LogMessageDisplay::Default);
 
+    /**
+    * @brief destinationPath Gets the path of the file written by a writer constructed with the given file name and
+    * folder, without constructing it.
+    * @param fileDestination The file name. If it is empty, the file is named after the current date.
+    * @param fileFolderDestination The folder of the file. If it is empty, the logs folder of the current path.
+    */
+    static QString destinationPath(const QString &fileDestination, const QString &fileFolderDestination);
+
     /**
     * @brief Gets path and folder of the file that will store the logs.
     */
@@ -62,7 +93,7 @@ public:
     * @brief Gets the current logging mode.
     * @return The level.
     */
-    LogMode getMode() const { return mMode; }
+    LogMode getMode() const { return config()->mode; }
 
     /**
     * @brief setLogMode Sets the log mode for this destination.
@@ -74,40 +105,119 @@ public:
     * @brief Gets the current level threshold.
     * @return The level.
     */
-    LogLevel getLevel() const { return mLevel; }
+    LogLevel getLevel() const { return config()->level; }
 
     /**
     * @brief setLogLevel Sets the log level for this destination.
     * @param level The new level threshold.
     */
-    void setLogLevel(LogLevel level) { mLevel = level; }
+    void setLogLevel(LogLevel level);
+
+    /**
+    * @brief isEnabled Checks without locking if a message of the given level would be written by this destination.
+    * @param level The level of the message.
+    * @return True if the destination is not disabled nor stop and the level passes its threshold.
+    */
+    bool isEnabled(LogLevel level) const
+    {
+        return static_cast<int>(level) >= mEnabledLevel.load(std::memory_order_relaxed);
+    }
+
+    /**
+    * @brief getEnabledLevel Gets the lowest level this destination writes. It is above LogLevel::Fatal if the
+    * destination is disabled or stop.
+    */
+    int getEnabledLevel() const { return mEnabledLevel.load(std::memory_order_relaxed); }
 
     /**
     * @brief Gets the current max size for the log file.
     * @return The maximum size
     */
-    int getMaxFileSize() const { return mMaxFileSize; }
+    qint64 getMaxFileSize() const { return mMaxFileSize.load(std::memory_order_relaxed); }
+
+    /**
+    * @brief setMaxFileSize Sets the max file size for this destination. When the file reaches it, it is renamed with
+    * the LogFileDisplay suffix and the logs continue in a new file. The file is also renamed when the day changes.
+    * @param maxSize The new file size, 0 to rotate only when the day changes.
+    */
+    void setMaxFileSize(qint64 maxSize) { mMaxFileSize.store(maxSize, std::memory_order_relaxed); }
+
+    /**
+    * @brief setQueueCapacity Sets the limits of the queue of messages waiting to be written. It must be called before
+    * logging: if the writer is already running, the number of messages can't grow beyond the current capacity.
+    * @param maxMessages The maximum number of messages in the queue.
+    * @param maxBytes The maximum memory used by the messages in the queue, 0 for no limit.
+    */
+    void setQueueCapacity(int maxMessages, qint64 maxBytes = 0);
+
+    /**
+    * @brief getQueueCapacity Gets the maximum number of messages in the queue.
+    */
+    int getQueueCapacity() const { return mQueueCapacity; }
+
+    /**
+    * @brief getQueueMaxBytes Gets the maximum memory used by the messages in the queue, 0 if there is no limit.
+    */
+    qint64 getQueueMaxBytes() const { return mQueueMaxBytes; }
+
+    /**
+    * @brief setOverflowPolicy Sets what happens with new messages when the queue is full. The number of discarded
+    * messages is written in the destination with the next batch.
+    * @param policy The overflow policy.
+    * @param sampleRate For LogOverflowPolicy::Sample, one in sampleRate messages is kept.
+    */
+    void setOverflowPolicy(LogOverflowPolicy policy, int sampleRate = 10);
+
+    /**
+    * @brief getOverflowPolicy Gets the overflow policy.
+    */
+    LogOverflowPolicy getOverflowPolicy() const { return config()->overflowPolicy; }
+
+    /**
+    * @brief setCompression Sets how the rotated files are compressed. The compression runs in the background.
+    * @param compression The compression method.
+    * @param level The compression level, from 1 (fastest) to 9 (smallest).
+    */
+    void setCompression(LogCompression compression, int level = 9)
+    {
+        mCompression      = compression;
+        mCompressionLevel = level;
+    }
+
+    /**
+    * @brief getCompression Gets how the rotated files are compressed.
+    */
+    LogCompression getCompression() const { return mCompression; }
+
+    /**
+    * @brief setRetention Sets the limits of the rotated files of the destination. The files over them are deleted in
+    * the background by QLoggerRetention.
+    */
+    void setRetention(const LogRetention &retention);
 
     /**
-    * @brief setMaxFileSize Sets the max file size for this destination.
-    * @param maxSize The new file size
+    * @brief getRetention Gets the limits of the rotated files of the destination.
     */
-    void setMaxFileSize(int maxSize) { mMaxFileSize = maxSize; }
+    LogRetention getRetention() const { return config()->retention; }
 
     /**
     * @brief getMessageOptions Gets the current message options.
     * @return The current options
     */
-    LogMessageDisplays getMessageOptions() const { return mMessageOptions; }
+    LogMessageDisplays getMessageOptions() const { return config()->messageOptions; }
 
     /**
     * @brief setMessageOptions Specifies what elements are displayed in one line of log message.
     * @param messageOptions The options
     */
-    void setMessageOptions(LogMessageDisplays messageOptions) { mMessageOptions = messageOptions; }
+    void setMessageOptions(LogMessageDisplays messageOptions)
+    {
+        updateConfig([messageOptions](Config &config) { config.messageOptions = messageOptions; });
+    }
 
     /**
-    * @brief enqueue Enqueues a message to be written in the destination.
+    * @brief enqueue Enqueues a message to be written in the destination. The line is formatted in the calling thread.
+    * @deprecated Enqueue a LogRecord instead, its line is formatted by the writer thread.
     * @param date The date and time of the log message.
     * @param threadId The thread where the message comes from.
     * @param module The module that writes the message.
@@ -117,19 +227,27 @@ public:
     * @param line The line of the file name that prints the log.
     * @param message The message to log.
     */
+    QT_DEPRECATED_X("Enqueue a LogRecord, which is formatted by the writer thread")
     void enqueue(const QDateTime &date, const QString &threadId, const QString &module, LogLevel level, const QString &function, const QString &fileName, int line, const QString &message);
 
+    /**
+    * @brief enqueue Enqueues a record to be formatted and written by the writer thread. The call doesn't take any
+    * lock unless the writer thread needs to be woken up or the queue is full.
+    * @param record The record with the raw values of the message.
+    */
+    void enqueue(LogRecord &&record);
+
     /**
     * @brief Stops the log writer
     * @param stop True to be stop, otherwise false
     */
-    void stop(bool stop) { mIsStop = stop; }
+    void stop(bool stop);
 
     /**
     * @brief Returns if the log writer is stop from writing.
     * @return True if is stop, otherwise false
     */
-    bool isStop() const { return mIsStop; }
+    bool isStop() const { return config()->stop; }
 
     /**
     * @brief run Overloaded method from QThread used to wait for new messages.
@@ -137,60 +255,531 @@ public:
     void run() override;
 
     /**
-    * @brief closeDestination Closes the destination. This needs to be called whenever
+    * @brief closeDestination Writes what is left in the queue and closes the destination from the calling thread. It
+    * is only used for destinations that no thread writes: the others are closed with requestClose.
     */
     void closeDestination();
 
-    //QLogger commit
+    /**
+    * @brief requestClose Asks the thread that writes the destination, its own or one of the pool, to write what is left
+    * in the queue and close the file. It returns right away: waitForClosed waits for it. The messages enqueued
+    * afterwards are discarded.
+    */
+    void requestClose();
+
+    /**
+    * @brief waitForClosed Waits until the destination is closed.
+    * @param deadline When to stop waiting.
+    * @return True if the destination is closed.
+    */
+    bool waitForClosed(QDeadlineTimer deadline);
+
+    /**
+    * @brief abandonClose Makes the destination that is being closed stop writing the queue after the current batch.
+    * The messages left are counted as dropped.
+    */
+    void abandonClose() { mAbandoned.store(true, std::memory_order_release); }
+
+    /**
+    * @brief setFlushPolicy Sets when the queued messages are written. A batch is written when its oldest message has
+    * waited maxLatency milliseconds or when it reaches batchMessages messages or batchBytes bytes, whatever comes
+    * first.
+    * @param maxLatency Maximum time in milliseconds a message waits in the queue. 0 writes every message right away.
+    * @param batchMessages Number of messages that triggers a write. 0 for no limit.
+    * @param batchBytes Memory used by the messages that triggers a write. 0 for no limit.
+    */
+    void setFlushPolicy(int maxLatency, int batchMessages, qint64 batchBytes);
+
+    /**
+    * @brief getFlushLatency Gets the maximum time in milliseconds a message waits in the queue.
+    */
+    int getFlushLatency() const { return config()->flushLatency; }
+
+    /**
+    * @brief setFormat Sets the format of the file. It must be called before the first message is logged: a file can't
+    * mix both formats. Binary files are read with QLoggerDecoder.
+    */
+    void setFormat(LogFormat format)
+    {
+        updateConfig([format](Config &config) { config.format = format; });
+    }
+
+    /**
+    * @brief getFormat Gets the format of the file.
+    */
+    LogFormat getFormat() const { return config()->format; }
+
+    /**
+    * @brief setEscaping Sets if the control characters of the text lines are escaped, so a message with new lines
+    * stays on one line of the file and of the console. See QLoggerUtf8::encode. It must be called before the first
+    * message is logged.
+    */
+    void setEscaping(bool escape)
+    {
+        updateConfig([escape](Config &config) { config.escape = escape; });
+    }
+
+    /**
+    * @brief isEscaping Gets if the control characters of the text lines are escaped.
+    */
+    bool isEscaping() const { return config()->escape; }
+
+    /**
+    * @brief formatLine Builds a log line.
+    * @param messageOptions The elements of the line.
+    * @param threshold The level of the destination. The file and the line are only displayed up to LogLevel::Debug.
+    * @return The line, ended by a new line.
+    */
+    static QString formatLine(LogMessageDisplays messageOptions, LogLevel threshold, const QString &date, const QString &threadId, const QString &module, LogLevel level, const QString &function, const QString &fileName, int line, const QString &message, const LogFields &fields = LogFields());
+
+    /**
+    * @brief appendLine Same as formatLine, but the line is appended to text without temporary strings, so a reused
+    * buffer doesn't allocate.
+    */
+    static void appendLine(QString &text, LogMessageDisplays messageOptions, LogLevel threshold, const QString &date, const QString &threadId, const QString &module, LogLevel level, const QString &function, const QString &fileName, int line, const QString &message, const LogFields &fields = LogFields());
+
+    /**
+    * @brief formatFields Builds the text of the fields of a structured message: " key1=value1 key2=value2". The values
+    * with spaces, quotes or equal signs are quoted.
+    */
+    static QString formatFields(const LogFields &fields);
+
+    /**
+    * @brief appendFields Same as formatFields, appending to text.
+    */
+    static void appendFields(QString &text, const LogFields &fields);
+
+    /**
+    * @brief setRingSize Sets the size of the ring file used in LogMode::MemoryMapped. It must be called before the
+    * first message is logged.
+    */
+    void setRingSize(qint64 size) { mRingSize = size; }
+
+    /**
+    * @brief forcePush Writes the queued messages without waiting for the flush policy.
+    */
     void forcePush();
 
+    /**
+    * @brief setDurability Sets when the messages are written to the disk.
+    * @param flushLevel The messages with this level or above are written right away: the producer waits until they
+    * are in the file. LogLevel::Fatal by default.
+    * @param syncInterval -1 to let the system write the file to the disk, 0 to sync the file after every write, or the
+    * minimum milliseconds between two syncs. With a positive value the writes of flushLevel messages are synced too.
+    */
+    void setDurability(LogLevel flushLevel, int syncInterval = -1);
+
+    /**
+    * @brief flush Waits until all the messages enqueued before the call are written and syncs the file to the disk.
+    */
+    void flush();
+
+    /**
+    * @brief stats Gets the counters of the destination. It can be called from any thread.
+    */
+    LogWriterStats stats() const;
+
+    /**
+    * @brief isActive Whether the queue is written, by the thread of the destination or by a QLoggerWriterPool.
+    */
+    bool isActive() const { return mPool || isRunning(); }
+
+    /**
+    * @brief addSink Adds an output that gets every batch written by the destination, next to its file and console.
+    * The sinks are not used in LogMode::MemoryMapped.
+    */
+    void addSink(std::shared_ptr<QLoggerSink> sink);
+
+    /**
+    * @brief formatRecord Builds the line of a record with the message options of the destination. It can only be
+    * called by the writer thread, as the sinks do.
+    */
+    QString formatRecord(const LogRecord &record);
+
 private:
-    bool mQuit   = false;
-    bool mIsStop = false;
+    /**
+    * @brief The QString copies of the function and file of a call site. The call sites live as long as the
+    * QLoggerManager, so they are converted once per writer.
+    */
+    struct SiteNames
+    {
+        QString function;
+        QString file;
+    };
+
+    bool mQuit = false;
+
+    /**
+    * @brief Set by requestClose. The thread that writes the destination drains the queue, unless mAbandoned is set,
+    * and then sets mClosed.
+    */
+    std::atomic<bool> mClosing { false };
+    std::atomic<bool> mAbandoned { false };
+    std::atomic<bool> mClosed { false };
     QWaitCondition mQueueNotEmpty;
     QString mFileDestinationFolder;
     QString mFileDestination;
     LogFileDisplay mFileSuffixIfFull;
-    LogMode mMode;
-    LogLevel mLevel;
+
+    /**
+    * @brief The settings that can be changed from any thread. Every change publishes a new snapshot, so the producers
+    * and the writer thread read them without locking while another thread changes them, and a batch is written with
+    * the mode it started with.
+    */
+    struct Config
+    {
+        LogLevel level = LogLevel::Warning;
+        LogMode mode   = LogMode::OnlyFile;
+        bool stop      = false;
+        LogMessageDisplays messageOptions;
+        LogOverflowPolicy overflowPolicy = LogOverflowPolicy::Block;
+        int sampleRate                   = 10;
+        int flushLatency                 = 500;
+        int flushBatchMessages           = 1024;
+        qint64 flushBatchBytes           = 1024 * 1024;
+        LogLevel flushLevel              = LogLevel::Fatal;
+        int syncInterval                 = -1;
+        LogFormat format                 = LogFormat::Text;
+        LogRetention retention;
+        bool escape = false;
+    };
+
+    /**
+    * @brief The published snapshot. The replaced ones are deleted by the next change or by the writer thread after a
+    * batch, once no reader is left. mConfigMutex serializes the changes.
+    */
+    QLoggerSnapshot<Config> mConfig;
+    QMutex mConfigMutex;
+    std::atomic<int> mEnabledLevel;
     QDate currentDate;               //QLogger commit
-    int mMaxFileSize = 1024 * 1024;  //! @note 1Mio
-    LogMessageDisplays mMessageOptions;
-    QVector<QString> mMessages;
+    std::atomic<qint64> mMaxFileSize { 512 * 1024 * 1024 };  //! @note 512Mio
+    qint64 mFileSize = 0;
+    int mNextFileNumber = 0;
+    LogCompression mCompression = LogCompression::SevenZip;
+    int mCompressionLevel       = 9;
+    int mQueueCapacity    = 8192;
+    qint64 mQueueMaxBytes = 0;
+    std::unique_ptr<QLoggerQueue<LogRecord>> mMessages;
+    std::atomic<qint64> mQueuedBytes { 0 };
+    std::atomic<quint64> mSampleCounter { 0 };
+    std::atomic<quint64> mDroppedMessages { 0 };
+
+    /**
+    * @brief The producers blocked by a full queue wait on mQueueNotFull. takeMessages only locks mRoomMutex to wake
+    * them up when mBlockedProducers says there are any.
+    */
+    QMutex mRoomMutex;
+    QWaitCondition mQueueNotFull;
+    std::atomic<int> mBlockedProducers { 0 };
+
+    /**
+    * @brief Counters of stats(). They are updated by the thread that writes the batch, except the sampled enqueue
+    * latency.
+    */
+    std::atomic<quint64> mWrittenMessages { 0 };
+    std::atomic<quint64> mDroppedTotal { 0 };
+    std::atomic<quint64> mBytesWritten { 0 };
+    std::atomic<quint64> mBatches { 0 };
+    std::atomic<qint64> mQueueHighWater { 0 };
+    QLoggerHistogram mBatchSize;
+    QLoggerHistogram mWriteLatency;
+    QLoggerHistogram mSyncLatency;
+    QLoggerHistogram mEnqueueLatency;
+    QLoggerTimestamp mTimestamps;
+    QHash<quintptr, QString> mThreadNames;
+    int mThreadNamesGeneration = -1;
     QMutex mutex;
 
-    //QLogger commit
-    QElapsedTimer wakeUpTime;
-    const int writeMSec = 1000;
-    static QMutex zipLock;
-    static QMutex writeLock;
-    QDateTime lastActive = QDateTime::currentDateTime();
+    /**
+    * @brief The destination stays open between batches. The lines of a batch are encoded in mBuffer, which is reused,
+    * and written with a single call. mFileMutex protects them when closeDestination writes from another thread.
+    */
+    QMutex mFileMutex;
+    QFile mFile;
+    QByteArray mBuffer;
+    QLoggerBinary mBinary;
+
+    /**
+    * @brief The console lines of a batch, split by stream and written with one call each. In LogMode::Full with the
+    * text format they are copied from the lines already encoded in mBuffer.
+    */
+    QByteArray mConsoleOutput;
+    QByteArray mConsoleError;
+    QByteArray mConsoleLine;
+    QVector<std::shared_ptr<QLoggerSink>> mSinks;
+
+    /**
+    * @brief Buffers reused by every batch: the records taken from the queue, the text of a line and its date. They
+    * keep their capacity, so once they fit the largest batch and line the writer doesn't allocate per message.
+    */
+    QVector<LogRecord> mBatch;
+    QString mLine;
+    QString mDate;
+    QHash<const LogCallSite *, SiteNames> mSiteNames;
+
+    /**
+    * @brief The ring of LogMode::MemoryMapped. It is created by the first message and kept until the writer is
+    * destroyed, so that producers never see it go away.
+    */
+    std::unique_ptr<QLoggerRing> mRing;
+    std::once_flag mRingOnce;
+    qint64 mRingSize = 16 * 1024 * 1024;
+
+    /**
+    * @brief The writer thread sleeps without timeout while the queue is empty (Idle). When the first message arrives it
+    * waits until the max latency expires or the batch limits are reached (Waiting), then it writes (Busy). The
+    * producers only take the mutex to wake it up on those two transitions.
+    */
+    enum class WriterState
+    {
+        Busy,
+        Idle,
+        Waiting
+    };
+
+    std::atomic<WriterState> mWriterState { WriterState::Busy };
+
+    /**
+    * @brief The pool that writes the queue instead of the thread of the destination. With a pool the Waiting state
+    * means the destination is scheduled in it.
+    */
+    QLoggerWriterPool *mPool = nullptr;
+    std::atomic<bool> mFlushRequested { false };
+    QWaitCondition mBatchWritten;
+    std::atomic<quint64> mWrittenPosition { 0 };
+    qint64 mLastSync       = 0;
+    bool mSyncWriteThrough = false;
+
+    /**
+    * @brief wakeUp Wakes up the writer thread to write the queue right away if it is not stop.
+    */
+    void wakeUp();
+
+    /**
+    * @brief notifyEnqueued Wakes up the writer thread if the new message is the first one of a batch or completes it.
+    */
+    void notifyEnqueued();
+
+    /**
+    * @brief isBatchFull Whether the queued messages reach the batch limits.
+    */
+    bool isBatchFull() const;
+
+    /**
+    * @brief ring Gets the ring file, mapping it the first time. Returns null if it can't be mapped.
+    */
+    QLoggerRing *ring();
+
+    /**
+    * @brief setPool Makes the threads of the pool write the queue. It must be called before the first message is
+    * enqueued and the thread of the destination is never started.
+    */
+    void setPool(QLoggerWriterPool *pool);
+
+    /**
+    * @brief writeBatch Writes the queue from a thread of the pool and schedules the destination again if messages
+    * arrived meanwhile.
+    */
+    void writeBatch();
+
+    /**
+    * @brief waitForBatch Waits until there is a batch to write or the destination is closed.
+    */
+    void waitForBatch();
+
+    /**
+    * @brief waitForWritten Waits until the messages before the position of the queue are written.
+    * @return False if the writer stopped before.
+    */
+    bool waitForWritten(quint64 position);
+
+    /**
+    * @brief syncDestination Syncs the file to the disk and records the time it took.
+    */
+    void syncDestination();
+
+    /**
+    * @brief writeQueue Writes the messages in the queue and updates the written position.
+    */
+    void writeQueue();
 
-    QString zipFileCustom(const QString &path);
+    /**
+    * @brief drainAndClose Writes the queue until it is empty or the close is abandoned, then closes the file and wakes
+    * up the threads that wait for it.
+    */
+    void drainAndClose();
+
+    /**
+    * @brief config Gets the current snapshot of the settings.
+    */
+    QLoggerSnapshot<Config>::Reader config() const { return mConfig.read(); }
+
+    /**
+    * @brief updateConfig Publishes a copy of the current snapshot changed by change.
+    */
+    template<typename Change>
+    void updateConfig(Change change)
+    {
+        QMutexLocker locker(&mConfigMutex);
+
+        auto config = *this->config();
+        change(config);
+        publishConfig(config);
+    }
+
+    /**
+    * @brief publishConfig Publishes a new snapshot of the settings and the level read by isEnabled. mConfigMutex must
+    * be locked.
+    */
+    void publishConfig(const Config &config);
+
+    /**
+    * @brief applyLevel Sets the level threshold without changing the level of the modules that log here.
+    */
+    void applyLevel(LogLevel level);
 
     /**
-    * @brief renameFileIfFull Truncates the log file in two. Keeps the filename for the new one and renames the old one
-    * with the timestamp or with a file number.
+    * @brief applyMode Sets the mode without updating the levels of the QLoggerManager.
+    */
+    void applyMode(LogMode mode);
+
+    /**
+    * @brief applyStop Stops or resumes the destination without updating the levels of the QLoggerManager.
+    */
+    void applyStop(bool stop);
+
+    /**
+    * @brief makeRoom Applies the overflow policy until there is room for a new message.
+    * @param size The memory used by the new message.
+    * @param config The settings read by the producer.
+    * @return False if the new message has to be discarded.
+    */
+    bool makeRoom(qint64 size, const Config &config);
+
+    /**
+    * @brief isFull Checks if a new message exceeds the limits of the queue.
+    */
+    bool isFull(qint64 size) const;
+
+    /**
+    * @brief waitForRoom Wakes the writer thread up and parks the producer until the writer has taken messages from
+    * the full queue, for a few milliseconds at most.
+    * @param size The memory used by the new message.
+    */
+    void waitForRoom(qint64 size);
+
+    /**
+    * @brief dropOldest Discards the oldest message of the queue.
+    */
+    void dropOldest();
+
+    /**
+    * @brief takeRecords Takes all the records that are currently in the queue. A record is added when messages were
+    * discarded.
+    * @param records Receives the records in the order they were enqueued, after the ones it already has.
+    */
+    void takeRecords(QVector<LogRecord> &records);
+
+    /**
+    * @brief threadName Gets the text displayed for a thread. The texts are cached until a thread name changes.
+    */
+    QString threadName(quintptr threadId);
+
+    /**
+    * @brief formatRecord Appends the line of a record to text. The date is formatted in mDate.
+    */
+    void formatRecord(QString &text, const LogRecord &record);
+
+    /**
+    * @brief siteNames Gets the names of a call site as QString.
+    */
+    const SiteNames &siteNames(const LogCallSite *site);
+
+    /**
+    * @brief formatMessage Builds a line with the message options of the destination.
+    */
+    QString formatMessage(const QString &date, const QString &threadId, const QString &module, LogLevel level, const QString &function, const QString &fileName, int line, const QString &message, const LogFields &fields = LogFields()) const
+    {
+        const auto config = this->config();
+
+        return formatLine(config->messageOptions, config->level, date, threadId, module, level, function, fileName, line, message, fields);
+    }
+
+    /**
+    * @brief renameFileIfFull Truncates the log file in two when the day changes or when it reaches the max size. Keeps
+    * the filename for the new one and renames the old one with the date, the timestamp or a file number. The size is
+    * the one tracked by the writer, so the file is not checked on disk.
     *
     * @return Returns the file name for the old logs.
     */
     QString renameFileIfFull();
 
     /**
-    * @brief generateDuplicateFilename
+    * @brief destinationFolder Gets the folder of the files written by the writers, ending with a separator.
+    */
+    static QString destinationFolder(const QString &fileFolderDestination);
+
+    /**
+    * @brief rotateFile Renames the log file and compresses it in the background.
+    * @return The new name of the file, empty if it couldn't be renamed.
+    */
+    QString rotateFile(const QString &newName);
+
+    /**
+    * @brief generateDuplicateFilename Gets the next numbered name for the log file. The folder is only read the first
+    * time, to continue after the highest number already used; then the number is incremented in memory.
     *
     * @param fileDestination The file path and name without the extension.
     * @param fileExtension The file extension
-    * @param fileSuffixNumber The file suffix number.
     * @return The complete path of the duplicated file name.
     */
-    static QString generateDuplicateFilename(const QString &fileDestination, const QString &fileExtension, int fileSuffixNumber = 1);
+    QString generateDuplicateFilename(const QString &fileDestination, const QString &fileExtension);
+
+    /**
+    * @brief openFile Opens the destination file if it is not open yet.
+    * @return True if the file is open.
+    */
+    bool openFile();
+
+    /**
+    * @brief closeFile Closes the destination file. It will be opened again by the next write.
+    */
+    void closeFile();
 
     /**
-    * @brief Writes a message in a file. If the file is full, it truncates it and prints a first line with the
-    * information of the old file.
+    * @brief appendText Encodes the text in UTF-8 at the end of a buffer, escaped if the destination escapes its
+    * lines.
+    */
+    void appendText(QByteArray &out, const QString &text);
+
+    /**
+    * @brief appendRecord Encodes a record at the end of the write buffer in the format of the destination and, in
+    * LogMode::Full, at the end of the console buffers.
+    * @param record The record.
+    * @param mode The mode of the batch.
+    */
+    void appendRecord(const LogRecord &record, LogMode mode);
+
+    /**
+    * @brief appendConsole Formats a record as text at the end of the console buffer of its level.
+    */
+    void appendConsole(const LogRecord &record);
+
+    /**
+    * @brief consoleBuffer Gets the console buffer of the stream of the level.
+    */
+    QByteArray &consoleBuffer(LogLevel level);
+
+    /**
+    * @brief Writes the records in the destination. If the file is full, it truncates it and prints a first line with
+    * the information of the old file.
     *
-    * @param message Pair of values consistent on the date and the message to be log.
+    * @param records The records in the order they were enqueued.
+    */
+    void write(const QVector<LogRecord> &records);
+
+    /**
+    * @brief Writes already formatted lines in the destination.
     */
     void write(const QVector<QString> &messages);
 };
@@ -0,0 +1,157 @@
+#include "QLoggerWriterPool.h"
+
+#include "QLoggerWriter.h"
+
+#include <QDeadlineTimer>
+
+namespace QLogger
+{
+
+class QLoggerWriterPool::Worker : public QThread
+{
+public:
+    Worker(QLoggerWriterPool *pool, int index)
+        : mPool(pool)
+        , mIndex(index)
+    {
+    }
+
+protected:
+    void run() override { mPool->work(mIndex); }
+
+private:
+    QLoggerWriterPool *mPool;
+    int mIndex;
+};
+
+QLoggerWriterPool::QLoggerWriterPool()
+{
+    mClock.start();
+}
+
+QLoggerWriterPool::~QLoggerWriterPool()
+{
+    setThreadCount(0);
+
+    for (const auto &worker : qAsConst(mWorkers))
+        worker->wait();
+}
+
+void QLoggerWriterPool::setThreadCount(int threads)
+{
+    QMutexLocker locker(&mMutex);
+
+    mThreadCount = qMax(threads, 0);
+
+    // The threads above the count end by themselves, the finished ones are replaced
+    for (auto i = 0; i < mThreadCount; ++i)
+    {
+        if (i >= mWorkers.size())
+            mWorkers.append(std::make_shared<Worker>(this, i));
+
+        if (!mWorkers.at(i)->isRunning())
+        {
+            mWorkers.at(i)->wait();
+            mWorkers.at(i)->start();
+        }
+    }
+
+    mScheduled.wakeAll();
+}
+
+int QLoggerWriterPool::threadCount() const
+{
+    QMutexLocker locker(&mMutex);
+
+    return mThreadCount;
+}
+
+void QLoggerWriterPool::add(QLoggerWriter *writer)
+{
+    QMutexLocker locker(&mMutex);
+
+    // The entry of a writer already in the pool may be scheduled or written right now
+    if (!mEntries.contains(writer))
+        mEntries.insert(writer, Entry());
+}
+
+void QLoggerWriterPool::remove(QLoggerWriter *writer)
+{
+    QMutexLocker locker(&mMutex);
+
+    while (mEntries.value(writer).writing)
+        mWritten.wait(&mMutex);
+
+    mEntries.remove(writer);
+}
+
+void QLoggerWriterPool::schedule(QLoggerWriter *writer, int delay)
+{
+    QMutexLocker locker(&mMutex);
+
+    const auto iter = mEntries.find(writer);
+
+    if (iter == mEntries.end())
+        return;
+
+    const auto due = mClock.elapsed() + delay;
+
+    if (!iter->scheduled || due < iter->due)
+    {
+        iter->scheduled = true;
+        iter->due       = due;
+
+        mScheduled.wakeOne();
+    }
+}
+
+void QLoggerWriterPool::work(int index)
+{
+    QMutexLocker locker(&mMutex);
+
+    while (index < mThreadCount)
+    {
+        // Earliest due destination that no other thread is writing
+        QLoggerWriter *next = nullptr;
+        qint64 due          = 0;
+
+        for (auto iter = mEntries.cbegin(); iter != mEntries.cend(); ++iter)
+        {
+            if (iter->scheduled && !iter->writing && (!next || iter->due < due))
+            {
+                next = iter.key();
+                due  = iter->due;
+            }
+        }
+
+        if (!next)
+        {
+            mScheduled.wait(&mMutex);
+            continue;
+        }
+
+        const auto wait = due - mClock.elapsed();
+
+        if (wait > 0)
+        {
+            mScheduled.wait(&mMutex, QDeadlineTimer(wait));
+            continue;
+        }
+
+        auto &entry     = mEntries[next];
+        entry.scheduled = false;
+        entry.writing   = true;
+
+        locker.unlock();
+        next->writeBatch();
+        locker.relock();
+
+        mEntries[next].writing = false;
+        mWritten.wakeAll();
+
+        // Another thread may be waiting for this destination to be free
+        mScheduled.wakeOne();
+    }
+}
+
+}  // namespace QLogger
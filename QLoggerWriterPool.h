@@ -0,0 +1,106 @@
+#pragma once
+
+/****************************************************************************************
+ ** QLogger is a library to register and print logs into a file.
+ ** Copyright (C) 2022 Francesc Martinez
+ **
+ ** LinkedIn: www.linkedin.com/in/cescmm/
+ ** Web: www.francescmm.com
+ **
+ ** This library is free software; you can redistribute it and/or
+ ** modify it under the terms of the GNU Lesser General Public
+ ** License as published by the Free Software Foundation; either
+ ** version 2 of the License, or (at your option) any later version.
+ **
+ ** This library is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ ** Lesser General Public License for more details.
+ **
+ ** You should have received a copy of the GNU Lesser General Public
+ ** License along with this library; if not, write to the Free Software
+ ** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***************************************************************************************/
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <memory>
+
+namespace QLogger
+{
+
+class QLoggerWriter;
+
+/**
+ * @brief The QLoggerWriterPool class writes the queues of many destinations with a few threads. A destination is
+ * scheduled when its first message arrives, due when its flush latency expires, and sooner when its batch is full or
+ * a producer waits for it. The threads always take the destination that is due first and a destination is only
+ * written by one thread at a time, so a busy destination can't starve the others.
+ */
+class QLoggerWriterPool
+{
+public:
+    QLoggerWriterPool();
+    ~QLoggerWriterPool();
+
+    QLoggerWriterPool(const QLoggerWriterPool &) = delete;
+    QLoggerWriterPool &operator=(const QLoggerWriterPool &) = delete;
+
+    /**
+    * @brief setThreadCount Sets the number of threads that write the destinations.
+    */
+    void setThreadCount(int threads);
+
+    /**
+    * @brief threadCount Gets the number of threads that write the destinations.
+    */
+    int threadCount() const;
+
+    /**
+    * @brief add Makes the pool write the queue of the destination.
+    */
+    void add(QLoggerWriter *writer);
+
+    /**
+    * @brief remove Stops writing the destination. It waits if a thread of the pool is writing it.
+    */
+    void remove(QLoggerWriter *writer);
+
+    /**
+    * @brief schedule Asks the pool to write the destination. If it is already scheduled, the earliest time is kept.
+    * @param writer The destination.
+    * @param delay The milliseconds before it has to be written.
+    */
+    void schedule(QLoggerWriter *writer, int delay);
+
+private:
+    class Worker;
+
+    struct Entry
+    {
+        qint64 due      = 0;
+        bool scheduled  = false;
+        bool writing    = false;
+    };
+
+    mutable QMutex mMutex;
+    QWaitCondition mScheduled;
+    QWaitCondition mWritten;
+    QHash<QLoggerWriter *, Entry> mEntries;
+    QVector<std::shared_ptr<Worker>> mWorkers;
+    int mThreadCount = 0;
+    QElapsedTimer mClock;
+
+    /**
+    * @brief work Loop of the threads of the pool.
+    * @param index The index of the thread. The thread ends when its index is above the thread count.
+    */
+    void work(int index);
+};
+
+}  // namespace QLogger